@@ -0,0 +1,296 @@
+#include "simulation.h"
+#include "scenarios.h"
+#include "diagnostics.h"
+#include "direct.h"
+#include "gravity_kernels.h"
+#include "parallel.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+
+//      :
+//   benchmark --scenarios all --sizes 1000,4000,16000 --threads 1,4 --solvers tree,fmm,pm,exact --steps 10 --format json
+//    -  ,  ,    
+
+namespace
+{
+	struct options
+	{
+		std::vector<grav::scenario> scenarios = { grav::scenario::uniform_box, grav::scenario::plummer,
+			grav::scenario::colliding_discs, grav::scenario::merging_cloud };
+		std::vector<size_t> sizes = { 1000, 4000, 16000, 64000, 256000, 1000000 };
+		std::vector<unsigned> threads;
+		std::vector<grav::solver> solvers = { grav::solver::barnes_hut, grav::solver::fmm, grav::solver::particle_mesh,
+			grav::solver::exact };
+		std::vector<grav::precision> precisions = { grav::precision::single };
+		int steps = 10;
+		float dt = 1.0f / 120.0f;
+		float theta = 0.5f;
+		int order = 4;
+		float fmm_theta = 0.5f;
+		int grid = 256;
+		bool p3m = false;
+		grav::Softening softening;
+		//   ;      
+		float border = 100.0f;
+		unsigned seed = 1;
+		grav::scheme method = grav::scheme::leapfrog;
+		float hermite_eta = 0.02f;
+		bool block = false;
+		//         , 0 - 
+		int reorder = 16;
+		grav::broadphase collisions = grav::broadphase::hash;
+		bool continuous = false;
+		bool refit = false;
+		grav::opening opening = grav::opening::geometric;
+		float tolerance = 0.005f;
+		//     , 0 -     
+		int group = 0;
+		bool pin = false;
+		//    N^2,      
+		size_t exact_limit = 65536;
+		//     N^2;       
+		size_t energy_limit = 32768;
+		//           , 0 -  
+		size_t error_samples = 1000;
+		bool csv = false;
+		const char* output = nullptr;
+	};
+
+	struct result
+	{
+		grav::scenario scene = grav::scenario::uniform_box;
+		size_t bodies = 0;
+		grav::solver gravity = grav::solver::barnes_hut;
+		grav::precision mode = grav::precision::single;
+		unsigned threads = 1;
+		int steps = 0;
+		double seconds = 0;
+		grav::SimulationStats stats{};
+		size_t final_bodies = 0;
+		bool has_energy = false;
+		double energy_drift = 0;
+		grav::ForceError force_error{};
+	};
+
+	template<typename T, typename Parse>
+	bool parse_list(const char* text, std::vector<T>& out, Parse parse) {
+		out.clear();
+		std::string list = text;
+		size_t start = 0;
+		while (start <= list.size()) {
+			size_t end = std::min(list.find(',', start), list.size());
+			T value;
+			if (!parse(list.substr(start, end - start), value)) return false;
+			out.push_back(value);
+			start = end + 1;
+		}
+		return !out.empty();
+	}
+
+	void usage() {
+		std::fprintf(stderr,
+			"usage: benchmark [--scenarios all|uniform_box,plummer,colliding_discs,merging_cloud]\n"
+			"                 [--sizes 1000,...] [--threads 1,...] [--solvers tree,fmm,pm,exact] [--steps K] [--dt h]\n"
+			"                 [--precision single,mixed,double] [--softening none|plummer|spline|truncated] [--softening-length l]\n"
+			"                 [--theta t] [--opening geometric|relative] [--tolerance a] [--refit] [--group G] [--order p] [--fmm-theta t] [--grid N] [--p3m] [--border B] [--seed S] [--block] [--reorder K] [--pin]\n"
+			"                 [--integrator leapfrog|verlet|hermite] [--hermite-eta a]\n"
+			"                 [--collisions hash|sweep] [--continuous]\n"
+			"                 [--exact-limit N] [--energy-limit N] [--error-samples N] [--format json|csv] [--output file]\n");
+	}
+
+	bool parse(int argc, char** argv, options& o) {
+		auto number = [](const std::string& s, size_t& v) { char* e; v = std::strtoull(s.c_str(), &e, 10); return !s.empty() && *e == 0; };
+		for (int i = 1; i < argc; i++) {
+			auto arg = [&](const char* name) { return std::strcmp(argv[i], name) == 0 && i + 1 < argc; };
+			if (arg("--scenarios")) {
+				if (std::strcmp(argv[i + 1], "all") == 0) i++;
+				else if (!parse_list(argv[++i], o.scenarios, [](const std::string& s, grav::scenario& v) { return grav::parse_scenario(s, v); })) return false;
+			}
+			else if (arg("--sizes")) { if (!parse_list(argv[++i], o.sizes, number)) return false; }
+			else if (arg("--threads")) {
+				if (!parse_list(argv[++i], o.threads, [&](const std::string& s, unsigned& v) { size_t n; bool ok = number(s, n) && n > 0; v = unsigned(n); return ok; })) return false;
+			}
+			else if (arg("--precision")) {
+				if (!parse_list(argv[++i], o.precisions, [](const std::string& s, grav::precision& v) { return grav::parse_precision(s, v); })) return false;
+			}
+			else if (arg("--solvers")) {
+				if (!parse_list(argv[++i], o.solvers, [](const std::string& s, grav::solver& v) { return grav::parse_solver(s, v); })) return false;
+			}
+			else if (arg("--softening")) { if (!grav::parse_softening(argv[++i], o.softening.model)) return false; }
+			else if (arg("--softening-length")) o.softening.length = float(std::atof(argv[++i]));
+			else if (arg("--steps")) o.steps = std::max(1, std::atoi(argv[++i]));
+			else if (arg("--dt")) o.dt = float(std::atof(argv[++i]));
+			else if (arg("--theta")) o.theta = float(std::atof(argv[++i]));
+			else if (arg("--opening")) { if (!grav::parse_opening(argv[++i], o.opening)) return false; }
+			else if (arg("--tolerance")) o.tolerance = float(std::atof(argv[++i]));
+			else if (arg("--order")) o.order = std::atoi(argv[++i]);
+			else if (arg("--fmm-theta")) o.fmm_theta = float(std::atof(argv[++i]));
+			else if (arg("--grid")) o.grid = std::atoi(argv[++i]);
+			else if (std::strcmp(argv[i], "--p3m") == 0) o.p3m = true;
+			else if (arg("--border")) o.border = float(std::atof(argv[++i]));
+			else if (arg("--seed")) o.seed = unsigned(std::atoi(argv[++i]));
+			else if (arg("--exact-limit")) o.exact_limit = std::strtoull(argv[++i], nullptr, 10);
+			else if (arg("--energy-limit")) o.energy_limit = std::strtoull(argv[++i], nullptr, 10);
+			else if (arg("--error-samples")) o.error_samples = std::strtoull(argv[++i], nullptr, 10);
+			else if (arg("--format")) o.csv = std::strcmp(argv[++i], "csv") == 0;
+			else if (arg("--output")) o.output = argv[++i];
+			else if (std::strcmp(argv[i], "--block") == 0) o.block = true;
+			else if (arg("--integrator")) { if (!grav::parse_scheme(argv[++i], o.method)) return false; }
+			else if (arg("--hermite-eta")) o.hermite_eta = float(std::atof(argv[++i]));
+			else if (arg("--reorder")) o.reorder = std::atoi(argv[++i]);
+			else if (std::strcmp(argv[i], "--continuous") == 0) o.continuous = true;
+			else if (std::strcmp(argv[i], "--refit") == 0) o.refit = true;
+			else if (arg("--group")) o.group = std::clamp(std::atoi(argv[++i]), 0, grav::QuadTree::max_group);
+			else if (arg("--collisions")) { if (!grav::parse_broadphase(argv[++i], o.collisions)) return false; }
+			else if (std::strcmp(argv[i], "--pin") == 0) o.pin = true;
+			else return false;
+		}
+		if (o.threads.empty()) {
+			//  : 1, 2, 4, ...   
+			unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+			for (unsigned t = 1; t < hw; t *= 2) o.threads.push_back(t);
+			o.threads.push_back(hw);
+		}
+		return true;
+	}
+
+	template<typename Real>
+	result run(const options& o, grav::scenario scene, size_t count, grav::solver gravity, unsigned threads, grav::precision mode) {
+		grav::thread_count = threads;
+		grav::pin_threads = o.pin;
+		grav::BasicSimulation<Real> sim;
+		sim.gravity = gravity;
+		sim.softening = o.softening;
+		sim.tree.theta = o.theta;
+		sim.tree.criterion = o.opening;
+		sim.tree.tolerance = o.tolerance;
+		sim.tree.refit = o.refit;
+		sim.tree.group_size = o.group;
+		sim.fmm.order = o.order;
+		sim.fmm.theta = o.fmm_theta;
+		sim.mesh.grid = o.grid;
+		sim.mesh.p3m = o.p3m;
+		sim.border = o.border;
+		sim.integrator.method = o.method;
+		sim.hermite.eta = o.hermite_eta;
+		sim.block_steps = o.block;
+		sim.reorder_interval = o.reorder;
+		sim.collisions = o.collisions;
+		sim.continuous = o.continuous;
+		grav::generate(scene, sim.bodies, count, o.seed);
+		sim.bodies.set_compensated(mode == grav::precision::mixed);
+
+		result r{ scene, count, gravity, mode, threads, o.steps };
+		r.has_energy = count <= o.energy_limit;
+		double e0 = r.has_energy ? grav::total_energy(sim.bodies, sim.softening) : 0.0;
+
+		//        ,    
+		sim.step(o.dt);
+		sim.stats = {};
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < o.steps; i++) sim.step(o.dt);
+		r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		r.stats = sim.stats;
+		r.final_bodies = sim.bodies.size();
+
+		//    ,    
+		r.energy_drift = r.has_energy && e0 != 0.0 ? ( grav::total_energy(sim.bodies, sim.softening) - e0 ) / std::abs(e0) : 0.0;
+
+		//        ;   -   
+		if (o.error_samples > 0) {
+			sim.compute_forces();
+			r.force_error = grav::force_error(sim.bodies, sim.softening, std::min(o.error_samples, sim.bodies.size()), o.seed);
+		}
+		return r;
+	}
+
+	result run(const options& o, grav::scenario scene, size_t count, grav::solver gravity, unsigned threads, grav::precision mode) {
+		if (mode == grav::precision::double_) return run<double>(o, scene, count, gravity, threads, mode);
+		return run<float>(o, scene, count, gravity, threads, mode);
+	}
+
+	void write(FILE* out, const std::vector<result>& results, const options& o) {
+		auto rate = [](double amount, double seconds) { return seconds > 0.0 ? amount / seconds : 0.0; };
+		if (o.csv) {
+			std::fprintf(out, "scenario,bodies,solver,precision,threads,steps,seconds,final_bodies,force_evaluations,interactions,merges,"
+				"interactions_per_sec,ns_per_body_step,merges_per_sec,energy_drift,force_error_median,force_error_p90,force_error_p99,force_error_max\n");
+			for (const result& r : results) {
+				std::fprintf(out, "%s,%zu,%s,%s,%u,%d,%.6f,%zu,%zu,%zu,%zu,%.6e,%.3f,%.3f,", grav::scenario_name(r.scene), r.bodies,
+					grav::solver_name(r.gravity), grav::precision_name(r.mode), r.threads, r.steps, r.seconds, r.final_bodies, r.stats.force_evaluations, r.stats.interactions,
+					r.stats.merges, rate(double(r.stats.interactions), r.seconds), rate(r.seconds * 1e9, double(r.stats.body_steps)),
+					rate(double(r.stats.merges), r.seconds));
+				if (r.has_energy) std::fprintf(out, "%.6e", r.energy_drift);
+				const grav::ForceError& e = r.force_error;
+				if (e.samples > 0) std::fprintf(out, ",%.3e,%.3e,%.3e,%.3e\n", e.median, e.p90, e.p99, e.max);
+				else std::fprintf(out, ",,,,\n");
+			}
+			return;
+		}
+		std::fprintf(out, "{\n  \"simd\": \"%s\",\n  \"dt\": %g,\n  \"theta\": %g,\n  \"opening\": \"%s\",\n  \"tolerance\": %g,\n  \"tree_refit\": %s,\n  \"tree_group\": %d,\n  \"fmm_order\": %d,\n  \"fmm_theta\": %g,\n  \"pm_grid\": %d,\n  \"p3m\": %s,\n  \"seed\": %u,\n  \"integrator\": \"%s\",\n  \"hermite_eta\": %g,\n  \"block_timesteps\": %s,\n  \"reorder_interval\": %d,\n  \"collisions\": \"%s\",\n  \"continuous\": %s,\n  \"pinned_threads\": %s,\n  \"results\": [\n",
+			grav::simd_name(grav::active_simd), o.dt, o.theta, grav::opening_name(o.opening), o.tolerance, o.refit ? "true" : "false", o.group, o.order, o.fmm_theta, o.grid, o.p3m ? "true" : "false", o.seed, grav::scheme_name(o.method), o.hermite_eta, o.block ? "true" : "false", o.reorder, grav::broadphase_name(o.collisions), o.continuous ? "true" : "false", o.pin ? "true" : "false");
+		for (size_t i = 0; i < results.size(); i++) {
+			const result& r = results[i];
+			std::fprintf(out, "    { \"scenario\": \"%s\", \"bodies\": %zu, \"solver\": \"%s\", \"precision\": \"%s\", \"threads\": %u, \"steps\": %d, "
+				"\"seconds\": %.6f, \"final_bodies\": %zu, \"force_evaluations\": %zu, \"interactions\": %zu, \"merges\": %zu, "
+				"\"interactions_per_sec\": %.6e, \"ns_per_body_step\": %.3f, \"merges_per_sec\": %.3f, \"energy_drift\": ",
+				grav::scenario_name(r.scene), r.bodies, grav::solver_name(r.gravity), grav::precision_name(r.mode), r.threads, r.steps, r.seconds, r.final_bodies,
+				r.stats.force_evaluations, r.stats.interactions, r.stats.merges, rate(double(r.stats.interactions), r.seconds),
+				rate(r.seconds * 1e9, double(r.stats.body_steps)), rate(double(r.stats.merges), r.seconds));
+			if (r.has_energy) std::fprintf(out, "%.6e", r.energy_drift);
+			else std::fprintf(out, "null");
+			const grav::ForceError& e = r.force_error;
+			if (e.samples > 0)
+				std::fprintf(out, ", \"force_error\": { \"samples\": %zu, \"median\": %.3e, \"p90\": %.3e, \"p99\": %.3e, \"max\": %.3e } }",
+					e.samples, e.median, e.p90, e.p99, e.max);
+			else std::fprintf(out, ", \"force_error\": null }");
+			std::fprintf(out, i + 1 < results.size() ? ",\n" : "\n");
+		}
+		std::fprintf(out, "  ]\n}\n");
+	}
+}
+
+int main(int argc, char** argv) {
+	options o;
+	if (!parse(argc, argv, o)) {
+		usage();
+		return 1;
+	}
+	//     ,           
+	if (o.method == grav::scheme::hermite && std::any_of(o.solvers.begin(), o.solvers.end(), [](grav::solver s) { return s != grav::solver::exact; })) {
+		std::fprintf(stderr, "--integrator hermite uses exact forces, pass --solvers exact\n");
+		return 1;
+	}
+
+	std::vector<result> results;
+	for (grav::scenario scene : o.scenarios)
+		for (size_t count : o.sizes)
+			for (grav::solver gravity : o.solvers) {
+				if (gravity == grav::solver::exact && count > o.exact_limit) {
+					std::fprintf(stderr, "skip %s %zu exact (above --exact-limit)\n", grav::scenario_name(scene), count);
+					continue;
+				}
+				for (grav::precision mode : o.precisions)
+					for (unsigned threads : o.threads) {
+						result r = run(o, scene, count, gravity, threads, mode);
+						std::fprintf(stderr, "%s %zu %s %s x%u: %.3f s\n", grav::scenario_name(scene), count, grav::solver_name(gravity),
+							grav::precision_name(mode), threads, r.seconds);
+						results.push_back(r);
+					}
+			}
+
+	FILE* out = o.output ? std::fopen(o.output, "w") : stdout;
+	if (!out) {
+		std::fprintf(stderr, "cannot open %s\n", o.output);
+		return 1;
+	}
+	write(out, results, o);
+	if (out != stdout) std::fclose(out);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "simulation.h"
+#include "scenarios.h"
+#include "direct.h"
+#include "gravity_kernels.h"
+#include "parallel.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <algorithm>
+
+//    :    scenarios.h (     S)    
+//   headless --scenario plummer --bodies 10000 --steps 100 --dt 0.0083 --solver tree --theta 0.5 --threads 8 --seed 1 --block
+static void usage();
+
+template<typename Real>
+static int run(grav::BasicSimulation<Real>& sim, grav::scenario scene, size_t count, int steps, float dt, float mass, unsigned seed,
+	size_t verify, grav::precision mode) {
+	grav::generate(scene, sim.bodies, count, seed, sim.border, mass);
+	sim.bodies.set_compensated(mode == grav::precision::mixed);
+
+	std::printf("scenario: %s, bodies: %zu, steps: %d, dt: %g, solver: %s, softening: %s %g, precision: %s, SIMD: %s, threads: %u\n",
+		grav::scenario_name(scene), count, steps, dt, grav::solver_name(sim.gravity), grav::softening_name(sim.softening.model),
+		sim.softening.length, grav::precision_name(mode),
+		grav::simd_name(grav::active_simd), grav::thread_count);
+
+	//   -   
+	if (sim.diagnostics.interval > 0) sim.diagnostics.record(sim.measure());
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < steps; i++) sim.step(dt);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::printf("time: %.3f s (%.3f ms per step)\n", seconds, steps > 0 ? seconds * 1000.0 / steps : 0.0);
+	std::printf("bodies left: %zu\n", sim.bodies.size());
+	if (sim.tree.refit && sim.stats.tree_builds + sim.stats.tree_refits > 0)
+		std::printf("tree: %zu builds, %zu refits\n", sim.stats.tree_builds, sim.stats.tree_refits);
+	if (sim.diagnostics.samples() > 1) {
+		const grav::ConservedQuantities& q = sim.diagnostics.last();
+		std::printf("diagnostics: %zu samples, energy %.6e (drift %.3e), momentum drift %.3e, angular momentum drift %.3e\n",
+			sim.diagnostics.samples(), q.energy(), sim.diagnostics.energy_drift(), sim.diagnostics.momentum_drift(),
+			sim.diagnostics.angular_drift());
+	}
+
+	if (verify > 0 && sim.gravity == grav::solver::fmm) {
+		//     ,         
+		grav::BodySystem single;
+		single.assign(sim.bodies);
+		sim.fmm.compute(single);
+		grav::ForceError e = sim.fmm.verify(single, std::min(verify, single.size()), seed);
+		std::printf("fmm order %d: relative error median %.3e, p90 %.3e, p99 %.3e, max %.3e over %zu bodies\n",
+			sim.fmm.order, e.median, e.p90, e.p99, e.max, e.samples);
+	}
+	else if (verify > 0 && sim.gravity == grav::solver::barnes_hut) {
+		//      -   
+		sim.compute_forces();
+		grav::ForceError e = grav::force_error(sim.bodies, sim.softening, std::min(verify, sim.bodies.size()), seed);
+		std::printf("tree %s: relative error median %.3e, p90 %.3e, p99 %.3e, max %.3e over %zu bodies\n",
+			grav::opening_name(sim.tree.criterion), e.median, e.p90, e.p99, e.max, e.samples);
+	}
+	return 0;
+}
+
+static void usage() {
+	std::printf("usage: headless [--scenario uniform_box|plummer|colliding_discs|merging_cloud] [--bodies N] [--steps K]\n"
+		"                [--dt h] [--mass m] [--solver exact|tree|fmm|pm] [--theta t] [--opening geometric|relative] [--tolerance a]\n"
+		"                [--refit] [--group G]\n"
+		"                [--softening none|plummer|spline|truncated] [--softening-length l]\n"
+		"                [--order p] [--fmm-theta t] [--verify samples] [--grid N] [--boundary periodic|isolated]\n"
+		"                [--p3m] [--split cells]\n"
+		"                [--integrator leapfrog|verlet|hermite] [--hermite-eta a] [--precision single|mixed|double] [--block] [--reorder K] [--threads T] [--pin] [--seed S] [--border B]\n"
+		"                [--collisions hash|sweep] [--continuous] [--diagnostics K] [--diagnostics-out file]\n");
+}
+
+int main(int argc, char** argv) {
+	grav::Simulation sim;
+	size_t count = 1000;
+	int steps = 100;
+	float dt = 1.0f / 120.0f;
+	float mass = 1.0f;
+	unsigned seed = 1;
+	grav::scenario scene = grav::scenario::uniform_box;
+	grav::precision mode = grav::precision::single;
+	//    FMM      
+	size_t verify = 0;
+	//      (CSV);   -   
+	const char* diagnostics_out = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		auto arg = [&](const char* name) { return std::strcmp(argv[i], name) == 0 && i + 1 < argc; };
+		if (arg("--bodies")) count = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg("--steps")) steps = std::atoi(argv[++i]);
+		else if (arg("--dt")) dt = float(std::atof(argv[++i]));
+		else if (arg("--mass")) mass = float(std::atof(argv[++i]));
+		else if (arg("--theta")) sim.tree.theta = float(std::atof(argv[++i]));
+		else if (arg("--opening")) {
+			if (!grav::parse_opening(argv[++i], sim.tree.criterion)) { usage(); return 1; }
+		}
+		else if (arg("--tolerance")) sim.tree.tolerance = float(std::atof(argv[++i]));
+		else if (arg("--threads")) grav::thread_count = unsigned(std::max(1, std::atoi(argv[++i])));
+		else if (arg("--seed")) seed = unsigned(std::atoi(argv[++i]));
+		else if (arg("--border")) sim.border = float(std::atof(argv[++i]));
+		else if (arg("--scenario")) {
+			if (!grav::parse_scenario(argv[++i], scene)) { usage(); return 1; }
+		}
+		else if (arg("--precision")) {
+			if (!grav::parse_precision(argv[++i], mode)) { usage(); return 1; }
+		}
+		else if (arg("--solver")) {
+			if (!grav::parse_solver(argv[++i], sim.gravity)) { usage(); return 1; }
+		}
+		else if (arg("--softening")) {
+			if (!grav::parse_softening(argv[++i], sim.softening.model)) { usage(); return 1; }
+		}
+		else if (arg("--softening-length")) sim.softening.length = float(std::atof(argv[++i]));
+		else if (arg("--order")) sim.fmm.order = std::atoi(argv[++i]);
+		else if (arg("--fmm-theta")) sim.fmm.theta = float(std::atof(argv[++i]));
+		else if (arg("--grid")) sim.mesh.grid = std::atoi(argv[++i]);
+		else if (arg("--boundary")) {
+			std::string s = argv[++i];
+			if (s == "periodic") sim.mesh.boundary = grav::mesh_boundary::periodic;
+			else if (s == "isolated") sim.mesh.boundary = grav::mesh_boundary::isolated;
+			else { usage(); return 1; }
+		}
+		else if (arg("--split")) sim.mesh.split = float(std::atof(argv[++i]));
+		else if (std::strcmp(argv[i], "--p3m") == 0) sim.mesh.p3m = true;
+		else if (arg("--verify")) verify = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg("--integrator")) {
+			if (!grav::parse_scheme(argv[++i], sim.integrator.method)) { usage(); return 1; }
+		}
+		else if (arg("--hermite-eta")) sim.hermite.eta = float(std::atof(argv[++i]));
+		else if (arg("--diagnostics")) sim.diagnostics.interval = std::max(0, std::atoi(argv[++i]));
+		else if (arg("--diagnostics-out")) diagnostics_out = argv[++i];
+		else if (std::strcmp(argv[i], "--block") == 0) sim.block_steps = true;
+		else if (arg("--reorder")) sim.reorder_interval = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--continuous") == 0) sim.continuous = true;
+		else if (std::strcmp(argv[i], "--refit") == 0) sim.tree.refit = true;
+		else if (arg("--group")) sim.tree.group_size = std::clamp(std::atoi(argv[++i]), 0, grav::QuadTree::max_group);
+		else if (arg("--collisions")) {
+			if (!grav::parse_broadphase(argv[++i], sim.collisions)) { usage(); return 1; }
+		}
+		else if (std::strcmp(argv[i], "--pin") == 0) grav::pin_threads = true;
+		else { usage(); return std::strcmp(argv[i], "--help") == 0 ? 0 : 1; }
+	}
+
+	//          ,     
+	if (sim.integrator.method == grav::scheme::hermite && sim.gravity != grav::solver::exact) {
+		std::fprintf(stderr, "--integrator hermite uses exact forces, pass --solver exact\n");
+		return 1;
+	}
+
+	std::FILE* log = stdout;
+	if (diagnostics_out && sim.diagnostics.interval > 0) {
+		log = std::fopen(diagnostics_out, "w");
+		if (!log) {
+			std::fprintf(stderr, "cannot open %s\n", diagnostics_out);
+			return 1;
+		}
+	}
+	sim.diagnostics.log = log;
+
+	int code;
+	if (mode == grav::precision::double_) {
+		grav::BasicSimulation<double> wide;
+		wide.copy_settings(sim);
+		code = run(wide, scene, count, steps, dt, mass, seed, verify, mode);
+	}
+	else code = run(sim, scene, count, steps, dt, mass, seed, verify, mode);
+	if (log != stdout) std::fclose(log);
+	return code;
+}
\ No newline at end of file
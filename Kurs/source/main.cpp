@@ -3,27 +3,112 @@
 #include <EvoNDZ/math/math.h>
 #include <EvoNDZ/input/input.h>
 #include <EvoNDZ/util/timer.h>
+#include <EvoNDZ/util/thread_pool.h>
 #include <EvoNDZ/math/vector2.h>
 #include <EvoNDZ/graphics/simple2d/renderer.h>
 #include <imgui/imgui.h>
+#include "simulation.h"
+#include "direct.h"
+#include "snapshot.h"
+#include "gravity_kernels.h"
+#include "parallel.h"
 #include <vector>
 #include <cmath>
 #include <algorithm>
-#include <execution>
+#include <thread>
+#include <string>
+#include <functional>
+#include <cstdio>
 	
 int window_width = 1440;
 int window_heigth = 768;
 float border = 100.0f;
-const float G = 0.01f;
 
-struct body
+// ,   ;      ,    
+struct Settings
 {
-	evo::Vector2f position;
-	evo::Vector2f velocity = evo::Vector2f(0, 0);
-	float mass;
-	float r;
-	//         
-	body(evo::Vector2f pos, float received_mass) { position = pos; mass = received_mass; r = sqrt(mass) * 0.01; }
+	grav::solver gravity;
+	grav::Softening softening;
+	float theta;
+	grav::opening opening;
+	float tolerance;
+	bool refit;
+	int group_size;
+	int fmm_order;
+	float fmm_theta;
+	int grid;
+	grav::mesh_boundary boundary;
+	bool p3m;
+	float split;
+	grav::scheme method;
+	bool compensated;
+	bool block_steps;
+	int max_level;
+	float eta;
+	float hermite_eta;
+	int reorder_interval;
+	grav::broadphase collisions;
+	bool continuous;
+	int diagnostics_interval;
+	unsigned threads;
+	bool pin;
+
+	void read(const grav::Simulation& sim) {
+		gravity = sim.gravity;
+		softening = sim.softening;
+		theta = sim.tree.theta;
+		opening = sim.tree.criterion;
+		tolerance = sim.tree.tolerance;
+		refit = sim.tree.refit;
+		group_size = sim.tree.group_size;
+		fmm_order = sim.fmm.order;
+		fmm_theta = sim.fmm.theta;
+		grid = sim.mesh.grid;
+		boundary = sim.mesh.boundary;
+		p3m = sim.mesh.p3m;
+		split = sim.mesh.split;
+		method = sim.integrator.method;
+		compensated = sim.bodies.compensated();
+		block_steps = sim.block_steps;
+		max_level = sim.blocks.max_level;
+		eta = sim.blocks.eta;
+		hermite_eta = sim.hermite.eta;
+		reorder_interval = sim.reorder_interval;
+		collisions = sim.collisions;
+		continuous = sim.continuous;
+		diagnostics_interval = sim.diagnostics.interval;
+		threads = grav::thread_count;
+		pin = grav::pin_threads;
+	}
+
+	void apply(grav::Simulation& sim) const {
+		sim.gravity = gravity;
+		sim.softening = softening;
+		sim.tree.theta = theta;
+		sim.tree.criterion = opening;
+		sim.tree.tolerance = tolerance;
+		sim.tree.refit = refit;
+		sim.tree.group_size = group_size;
+		sim.fmm.order = fmm_order;
+		sim.fmm.theta = fmm_theta;
+		sim.mesh.grid = grid;
+		sim.mesh.boundary = boundary;
+		sim.mesh.p3m = p3m;
+		sim.mesh.split = split;
+		sim.integrator.method = method;
+		sim.bodies.set_compensated(compensated);
+		if (sim.block_steps != block_steps) sim.invalidate_forces();
+		sim.block_steps = block_steps;
+		sim.blocks.max_level = max_level;
+		sim.blocks.eta = eta;
+		sim.hermite.eta = hermite_eta;
+		sim.reorder_interval = reorder_interval;
+		sim.collisions = collisions;
+		sim.continuous = continuous;
+		sim.diagnostics.interval = diagnostics_interval;
+		grav::thread_count = threads;
+		grav::pin_threads = pin;
+	}
 };
 
 class MyScene final : public evo::Scene {
@@ -36,11 +121,36 @@ public:
 	bool cam_mov_down = false;
 	bool linedraw = false;
 
-	std::vector<body> bodies;
+	//      Simulation,      
+	grav::Simulation sim;
+	grav::BodySystem& bodies = sim.bodies;
+	//     
+	grav::FixedStep clock;
+	Settings settings;
+
+	//   N+1    ,      N;
+	// sim     sync()
+	evo::ThreadPool physics { 1 };
+	evo::TaskGroup physics_job;
+	bool physics_running = false;
+	grav::IndexMap physics_map;
+	grav::SnapshotBuffer frames;
+	//     ,    
+	std::vector<std::function<void()>> commands;
+	size_t evaluations = 0, global_evaluations = 0;
+	//    ;      diagnostics.csv
+	grav::ConservedQuantities conserved;
+	size_t conserved_samples = 0;
+	double energy_drift = 0.0, momentum_drift = 0.0, angular_drift = 0.0;
+	bool log_diagnostics = false;
+	std::FILE* diagnostics_file = nullptr;
+
 	evo::Camera2D<float> camera;
 	evo::Vector2f mousepos;
 	int chosen_ind = -1;
 	float creation_mass = 1;
+	grav::ForceError fmm_error;
+	grav::ForceError tree_error;
 
 	void initialize() override {
 
@@ -54,6 +164,8 @@ public:
 			inputMap.bind(id, k, press);
 		};	
 		srand(frameTimer.time<unsigned int, std::nano>());
+		sim.border = border;
+		settings.read(sim);
 
 		//   
 
@@ -62,13 +174,16 @@ public:
 			{
 				double x, y;
 				evo::input::mouse_position_normalized(x, y);
-				bodies.emplace_back(camera.screen_to_world({float(x), float(y)}), creation_mass);
+				evo::Vector2f position = camera.screen_to_world({ float(x), float(y) });
+				commands.push_back([this, position, mass = creation_mass]() { sim.spawn(position, mass); });
 			});
 
 		//  1000 
 		key(11, evo::input::Key::S, true, [this]() {
-			for (int  = 0;  < 1000; ++)
-			bodies.emplace_back(evo::Vector2f((rand() / (float)RAND_MAX) * border - (border / 2), (rand() / (float)RAND_MAX) * border - (border / 2)), creation_mass);
+			commands.push_back([this, mass = creation_mass]() {
+				for (int  = 0;  < 1000; ++)
+				sim.spawn(evo::Vector2f((rand() / (float)RAND_MAX) * border - (border / 2), (rand() / (float)RAND_MAX) * border - (border / 2)), mass);
+				});
 			});
 
 		//    
@@ -78,7 +193,8 @@ public:
 		key(12, evo::input::Key::MouseLeft, true, [this]()
 			{
 				linedraw = true;
-				for (int a = 0; a < bodies.size(); a++) if ((bodies[a].position - mousepos).sqrlen() < bodies[a].r * bodies[a].r) chosen_ind = a;
+				const grav::BodySnapshot& shown = frames.front();
+				for (int a = 0; a < shown.size(); a++) if ((shown.position(a) - mousepos).sqrlen() < shown.r[a] * shown.r[a]) chosen_ind = a;
 			});
 
 		key(14, evo::input::Key::MouseLeft, false, [this]()
@@ -86,8 +202,15 @@ public:
 				linedraw = false;
 				if (chosen_ind != -1)
 				{
-					evo::Vector2f velocitychg = mousepos - bodies[chosen_ind].position;
-					if ((mousepos - bodies[chosen_ind].position).sqrlen() > bodies[chosen_ind].r * bodies[chosen_ind].r) bodies[chosen_ind].velocity += velocitychg;
+					const grav::BodySnapshot& shown = frames.front();
+					evo::Vector2f velocitychg = mousepos - shown.position(chosen_ind);
+					//    chosen_ind     
+					if (velocitychg.sqrlen() > shown.r[chosen_ind] * shown.r[chosen_ind])
+						commands.push_back([this, velocitychg]() {
+							if (chosen_ind == -1) return;
+							bodies[chosen_ind].velocity += velocitychg;
+							sim.diagnostics.reset();
+						});
 				}
 			});
 
@@ -98,12 +221,18 @@ public:
 		};
 
 		//  
-		key(13, evo::input::Key::F, true, [this]() { bodies.clear(); bodies.shrink_to_fit(); chosen_ind = -1; });
+		key(13, evo::input::Key::F, true, [this]() { commands.push_back([this]() { sim.clear(); chosen_ind = -1; }); });
 
 		//    
 		key(15, evo::input::Key::T, true, [this]() { creation_mass *= 2; });
 		key(16, evo::input::Key::Y, true, [this]() { if (creation_mass > 0.9f) creation_mass /= 2; });
 
+		//    ;    
+		key(17, evo::input::Key::B, true, [this]()
+			{
+				if (settings.method != grav::scheme::hermite) settings.gravity = grav::solver(( int(settings.gravity) + 1 ) % 4);
+			});
+
 		//  
 		inputMap.simple_switch(3, 4, evo::input::Key::Left, [this]() {cam_mov_left = true; }, [this]() {cam_mov_left = false; });
 		inputMap.simple_switch(5, 6, evo::input::Key::Right, [this]() {cam_mov_right = true; }, [this]() {cam_mov_right = false; });
@@ -124,44 +253,14 @@ public:
 		evo::input::mouse_position_normalized(xmpn, ympn);
 		mousepos = camera.screen_to_world({ float(xmpn), float(ympn) });
 
+		sync();
 		if (pause)
 		{
-			//  
-			for (int a = 0; a < bodies.size(); a++) for (int b = 0; b < bodies.size(); b++)
-				if (a != b) if ((bodies[a].position - bodies[b].position).sqrlen() < evo::math::sqr(bodies[a].r + bodies[b].r))
-				{
-					bool swapwas = false;
-					if (bodies[a].mass < bodies[b].mass) { std::swap(a, b); swapwas = true; }
-					bodies[a].velocity = bodies[a].velocity / ((bodies[a].mass + bodies[b].mass) / bodies[a].mass);
-					bodies[a].mass += bodies[b].mass;
-					bodies[a].r = sqrt(bodies[a].mass) * 0.01;
-					bodies.erase(bodies.begin() + b);
-					if (a >= b) a--;
-					if (chosen_ind == b) chosen_ind = a;
-					else if (chosen_ind > b) chosen_ind--;
-					b--;
-					if (swapwas) std::swap(a, b);
-				}
-
-			//      
-			std::for_each(std::execution::par_unseq, bodies.begin(), bodies.end(), [this, dt](body& a)
-				{
-					for (int b = &a - bodies.data() + 1; b < bodies.size(); b++)
-					{
-						evo::Vector2f gravity = (0.01f + (bodies[b].position - a.position).normalized()) * G / (bodies[b].position - a.position).sqrlen();
-						a.velocity += gravity * (dt * bodies[b].mass);
-						bodies[b].velocity -= gravity * (dt * a.mass);
-					}
-				});
-			for (body& a : bodies) a.position += a.velocity * dt;
-
-			//  
-			for (body& a : bodies) if (a.position.x >= border || a.position.x <= -border || a.position.y >= border || a.position.y <= -border)
-			{
-				a.position += -a.velocity * dt;
-				a.velocity = -a.velocity / 10.0f;
-			}
+			//     ,     
+			int steps = clock.advance(dt);
+			if (steps > 0) launch(steps, clock.step);
 		}
+		else clock.reset();
 
 		//  
 		if (cam_mov_left) camera.move_on(evo::Vector2f::X(-dt * camera.scale().x));
@@ -169,17 +268,64 @@ public:
 		if (cam_mov_up) camera.move_on(evo::Vector2f::Y(dt * camera.scale().y));
 		if (cam_mov_down) camera.move_on(evo::Vector2f::Y(-dt * camera.scale().y));
 	}
+
+	//  ,   ,       
+	void sync() {
+		if (physics_running)
+		{
+			physics.wait(physics_job);
+			physics_running = false;
+			frames.publish();
+			chosen_ind = physics_map(chosen_ind);
+		}
+		settings.apply(sim);
+		if (!commands.empty())
+		{
+			for (auto& c : commands) c();
+			commands.clear();
+			frames.back().take(bodies);
+			frames.publish();
+		}
+		const bool hermite = sim.integrator.method == grav::scheme::hermite;
+		evaluations = hermite ? sim.hermite.evaluations() : sim.blocks.evaluations();
+		global_evaluations = hermite ? sim.hermite.global_evaluations() : sim.blocks.global_evaluations();
+		if (log_diagnostics && !diagnostics_file) diagnostics_file = std::fopen("diagnostics.csv", "w");
+		if (!log_diagnostics && diagnostics_file)
+		{
+			std::fclose(diagnostics_file);
+			diagnostics_file = nullptr;
+		}
+		sim.diagnostics.log = diagnostics_file;
+		conserved = sim.diagnostics.last();
+		conserved_samples = sim.diagnostics.samples();
+		energy_drift = sim.diagnostics.energy_drift();
+		momentum_drift = sim.diagnostics.momentum_drift();
+		angular_drift = sim.diagnostics.angular_drift();
+	}
+
+	// steps    ;       
+	void launch(int steps, float h) {
+		physics_running = true;
+		physics.submit(physics_job, [this, steps, h]() {
+			grav::IndexMap map;
+			for (int i = 0; i < steps; i++) map = map.then(sim.step(h));
+			physics_map = std::move(map);
+			frames.back().take(bodies);
+		});
+	}
+
 	void render() override {
+		const grav::BodySnapshot& shown = frames.front();
 
 		//      
-		if (linedraw && chosen_ind != -1) batch->line(mousepos, bodies[chosen_ind].position, bodies[chosen_ind].r / 2);
+		if (linedraw && chosen_ind != -1) batch->line(mousepos, shown.position(chosen_ind), shown.r[chosen_ind] / 2);
 		
 		//      
-		for (const body& a : bodies) batch->circle(a.position, a.r);
+		for (size_t a = 0; a < shown.size(); a++) batch->circle(shown.position(a), shown.r[a]);
 		if (chosen_ind != -1)
 		{
-			batch->circle(bodies[chosen_ind].position, bodies[chosen_ind].r, evo::Color3f(1.0f, 0.0f, 0.0f));
-			batch->line(bodies[chosen_ind].position, bodies[chosen_ind].velocity + bodies[chosen_ind].position, bodies[chosen_ind].r / 2);
+			batch->circle(shown.position(chosen_ind), shown.r[chosen_ind], evo::Color3f(1.0f, 0.0f, 0.0f));
+			batch->line(shown.position(chosen_ind), shown.velocity(chosen_ind) + shown.position(chosen_ind), shown.r[chosen_ind] / 2);
 		}
 
 		//  
@@ -196,14 +342,121 @@ public:
 		// gui
 		ImGui::Begin("Info");
 		//ImGui::Text("%.1f", 1 / frameTimer.time<double>());
-		ImGui::Text("Amount of bodies: %i", bodies.size());
-		if (chosen_ind != -1) ImGui::Text("Chosen body mass: %.f", bodies[chosen_ind].mass);
+		const grav::BodySnapshot& shown = frames.front();
+		ImGui::Text("Amount of bodies: %i", shown.size());
+		if (chosen_ind != -1) ImGui::Text("Chosen body mass: %.f", shown.mass[chosen_ind]);
 		ImGui::Text("Mass of a spawned body: %.f", creation_mass);
+		ImGui::Text("SIMD: %s", grav::simd_name(grav::active_simd));
+		//         ,      
+		if (settings.method == grav::scheme::hermite) ImGui::Text("Gravity: exact (required by Hermite)");
+		else
+		{
+			int solver_ind = int(settings.gravity);
+			ImGui::Combo("Gravity (B)", &solver_ind, "Exact\0Barnes-Hut\0FMM\0Particle-mesh\0");
+			settings.gravity = grav::solver(solver_ind);
+		}
+		if (settings.gravity != grav::solver::particle_mesh)
+		{
+			int softening = int(settings.softening.model);
+			ImGui::Combo("Softening", &softening, "None\0Plummer\0Spline\0Truncated\0");
+			settings.softening.model = grav::softening_model(softening);
+			if (settings.softening.model != grav::softening_model::none)
+				ImGui::SliderFloat("Softening length", &settings.softening.length, 0.001f, 1.0f, "%.3f", ImGuiSliderFlags_Logarithmic);
+		}
+		if (settings.gravity == grav::solver::barnes_hut)
+		{
+			ImGui::SliderFloat("Theta", &settings.theta, 0.1f, 1.5f);
+			//        , theta     
+			int opening = int(settings.opening);
+			ImGui::Combo("Opening", &opening, "Geometric\0Relative\0");
+			settings.opening = grav::opening(opening);
+			if (settings.opening == grav::opening::relative)
+				ImGui::SliderFloat("Force tolerance", &settings.tolerance, 0.0001f, 0.1f, "%.4f", ImGuiSliderFlags_Logarithmic);
+			//       ,       
+			ImGui::Checkbox("Refit tree", &settings.refit);
+			//      , 0 -  
+			ImGui::SliderInt("Walk group", &settings.group_size, 0, grav::QuadTree::max_group);
+			if (ImGui::Button("Verify against exact")) commands.push_back([this]()
+				{
+					sim.compute_forces();
+					tree_error = grav::force_error(sim.bodies, sim.softening, std::min<size_t>(1000, sim.bodies.size()));
+					sim.invalidate_forces();
+				});
+			if (tree_error.samples) ImGui::Text("Error: median %.1e, p90 %.1e, p99 %.1e", tree_error.median, tree_error.p90, tree_error.p99);
+		}
+		if (settings.gravity == grav::solver::fmm)
+		{
+			ImGui::SliderInt("Expansion order", &settings.fmm_order, 1, 12);
+			ImGui::SliderFloat("Separation", &settings.fmm_theta, 0.1f, 0.95f);
+			//          
+			if (ImGui::Button("Verify against exact")) commands.push_back([this]()
+				{
+					sim.fmm.softening = sim.softening;
+					sim.fmm.compute(bodies);
+					fmm_error = sim.fmm.verify(bodies, std::min<size_t>(1000, bodies.size()));
+					sim.invalidate_forces();
+				});
+			if (fmm_error.samples) ImGui::Text("Error: median %.1e, p90 %.1e, p99 %.1e", fmm_error.median, fmm_error.p90, fmm_error.p99);
+		}
+		if (settings.gravity == grav::solver::particle_mesh)
+		{
+			//   -    64  2048
+			int grid_power = 0;
+			while (( 64 << ( grid_power + 1 ) ) <= settings.grid) grid_power++;
+			if (ImGui::SliderInt("Mesh size", &grid_power, 0, 5, std::to_string(64 << grid_power).c_str())) settings.grid = 64 << grid_power;
+			int boundary = int(settings.boundary);
+			ImGui::Combo("Mesh boundary", &boundary, "Periodic\0Isolated\0");
+			settings.boundary = grav::mesh_boundary(boundary);
+			ImGui::Checkbox("P3M short-range correction", &settings.p3m);
+			if (settings.p3m) ImGui::SliderFloat("Split (cells)", &settings.split, 0.5f, 4.0f);
+		}
+		int method = int(settings.method);
+		ImGui::Combo("Integrator", &method, "Leapfrog (KDK)\0Velocity Verlet\0Hermite (4th order)\0");
+		settings.method = grav::scheme(method);
+		if (settings.method == grav::scheme::hermite) settings.gravity = grav::solver::exact;
+		ImGui::SliderFloat("Physics step", &clock.step, 0.001f, 0.05f, "%.4f");
+		ImGui::SliderInt("Max steps per frame", &clock.max_substeps, 1, 32);
+		//      float  ,   
+		ImGui::Checkbox("Mixed precision (compensated)", &settings.compensated);
+		ImGui::Checkbox("Block timesteps", &settings.block_steps);
+		if (settings.block_steps)
+		{
+			ImGui::SliderInt("Finest level", &settings.max_level, 0, 10);
+			if (settings.method == grav::scheme::hermite) ImGui::SliderFloat("Step accuracy", &settings.hermite_eta, 0.001f, 0.1f, "%.3f", ImGuiSliderFlags_Logarithmic);
+			else ImGui::SliderFloat("Step accuracy", &settings.eta, 0.005f, 0.5f);
+			ImGui::Text("Force evaluations: %zu (global step: %zu)", evaluations, global_evaluations);
+		}
+		// 0 -   
+		ImGui::SliderInt("Reorder every N steps", &settings.reorder_interval, 0, 256);
+		int collisions = int(settings.collisions);
+		ImGui::Combo("Collisions", &collisions, "Hash grid\0Sweep and prune\0");
+		settings.collisions = grav::broadphase(collisions);
+		//       ,       
+		ImGui::Checkbox("Continuous collisions", &settings.continuous);
+		int threads = int(settings.threads);
+		if (ImGui::SliderInt("Threads", &threads, 1, int(std::max(1u, std::thread::hardware_concurrency())))) settings.threads = unsigned(threads);
+		ImGui::Checkbox("Pin threads to cores", &settings.pin);
+		// 0 -  ;     ,    
+		ImGui::SliderInt("Diagnostics every N steps", &settings.diagnostics_interval, 0, 256);
+		if (settings.diagnostics_interval > 0)
+		{
+			ImGui::Checkbox("Log to diagnostics.csv", &log_diagnostics);
+			if (conserved_samples > 0)
+			{
+				ImGui::Text("Energy: %.6e (K %.4e, U %.4e)", conserved.energy(), conserved.kinetic, conserved.potential);
+				ImGui::Text("Energy drift: %.3e", energy_drift);
+				ImGui::Text("Momentum: (%.4e, %.4e), drift %.3e", conserved.px, conserved.py, momentum_drift);
+				ImGui::Text("Angular momentum: %.4e, drift %.3e", conserved.angular, angular_drift);
+				ImGui::Text("Centre of mass: (%.4f, %.4f)", conserved.cx, conserved.cy);
+			}
+		}
 		ImGui::End();
 	}
 	void terminate() override {
 
 		// terminate
+		if (physics_running) physics.wait(physics_job);
+		if (diagnostics_file) std::fclose(diagnostics_file);
 		delete batch;
 	}
 
@@ -0,0 +1,646 @@
+#pragma once
+#include <EvoNDZ/math/vector2.h>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <string_view>
+#include "body_system.h"
+#include "gravity_kernels.h"
+#include "index_map.h"
+#include "morton.h"
+#include "parallel.h"
+#include "softening.h"
+
+namespace grav
+{
+	//       
+	enum class opening { geometric, relative };
+
+	inline const char* opening_name(opening o) {
+		switch (o) {
+		case opening::geometric: return "geometric";
+		case opening::relative: return "relative";
+		}
+		return "?";
+	}
+
+	inline bool parse_opening(std::string_view name, opening& o) {
+		for (opening c : { opening::geometric, opening::relative })
+			if (name == opening_name(c)) {
+				o = c;
+				return true;
+			}
+		return false;
+	}
+
+	//  -,        
+	template<std::floating_point Real>
+	class BasicQuadTree {
+	public:
+		using vector = evo::Vector2<Real>;
+
+		//  :   ,    < theta * 
+		float theta = 0.5f;
+		//   (  Gadget):   M   l  ,   
+		//   G M l^2 / d^4   tolerance * |a|,  a -     .
+		//    ,        ;
+		//     ( ,  )    theta
+		opening criterion = opening::geometric;
+		float tolerance = 0.005f;
+		//     
+		Softening softening;
+
+		// update    :        ,
+		//    ,          
+		bool refit = false;
+		//      ,    
+		float rebuild_fraction = 0.05f;
+
+		// accelerations   :      group_size     ,
+		// ,    ,        ,     
+		//      (0 -     )
+		int group_size = 0;
+		static constexpr int max_group = 64;
+
+		//   :     ,    
+		//            ,
+		//       -    ,     
+		void build(const BasicBodySystem<Real>& bodies) {
+			const size_t n = bodies.size();
+			m_count = n;
+			m_valid = true;
+			m_chained = 0;
+			m_root = no_root;
+			m_free.clear();
+			m_nodes.resize(n == 0 ? 0 : n - 1);
+			m_leaf_parent.assign(n, -1);
+			m_leaf_prefix.resize(n);
+			m_leaves.resize(n);
+			m_keys.resize(n);
+			if (n == 0) return;
+
+			m_square = morton_codes(bodies, m_codes, refit ? Real(margin) : Real(0));
+			m_order.resize(n);
+			for (uint32_t i = 0; i < n; i++) m_order[i] = i;
+			radix_sort(m_codes, m_order);
+
+			m_root = n == 1 ? leaf(m_order[0]) : 0;
+			m_parent.assign(n - 1, -1);
+			parallel_for(n, [this, n](size_t k) {
+				m_keys[m_order[k]] = m_codes[k];
+				if (k + 1 < n) link(int(k));
+			});
+			aggregate(bodies);
+		}
+
+		//    :   ,   refit    ,
+		//   ;  true,    
+		bool update(const BasicBodySystem<Real>& bodies) {
+			if (!refit || !m_valid || m_count == 0 || bodies.size() < m_count || !reinsert(bodies)) {
+				build(bodies);
+				return true;
+			}
+			aggregate(bodies);
+			//       -   ,  ,    
+			if (m_root >= 0 && ( m_nodes[m_root].hi - m_nodes[m_root].lo ).max() * 4 < m_square.side) m_valid = false;
+			return false;
+		}
+
+		//   (, ):    ,   ;
+		// ,    , update  
+		void remap(const IndexMap& map, size_t new_size) {
+			if (map.identity() || !m_valid) return;
+			if (map.old_size() < m_count) {
+				m_valid = false;
+				return;
+			}
+			for (size_t b = 0; b < m_count; b++)
+				if (!map.survives(int(b))) remove(int(b));
+
+			//    ,   :      
+			//     
+			std::vector<uint8_t> sides(m_count, 0);
+			for (size_t b = 0; b < m_count; b++)
+				if (map.survives(int(b)) && m_leaf_parent[b] >= 0) sides[b] = m_nodes[m_leaf_parent[b]].child[1] == leaf(int(b));
+			size_t count = 0;
+			for (size_t b = 0; b < m_count; b++) {
+				if (!map.survives(int(b))) continue;
+				if (m_leaf_parent[b] >= 0) m_nodes[m_leaf_parent[b]].child[sides[b]] = leaf(map(int(b)));
+				else m_root = leaf(map(int(b)));
+				count++;
+			}
+			map.apply(m_leaf_parent, new_size, -1);
+			map.apply(m_leaf_prefix, new_size);
+			map.apply(m_keys, new_size);
+			map.apply(m_leaves, new_size);
+			//      [0, count),     
+			bool tail = true;
+			for (size_t b = 0; b < count; b++) tail &= m_leaf_parent[b] != -1 || m_root == leaf(int(b));
+			m_count = count;
+			if (!tail) m_valid = false;
+		}
+
+		void reset() noexcept {
+			m_valid = false;
+		}
+
+		// ,       p ( self );
+		//  interactions,   ,    .
+		// previous -         
+		vector acceleration(vector p, int self = -1, size_t* interactions = nullptr, Real previous = 0) const {
+			return with_softening(softening.model, [&](auto soft) {
+				using Soft = decltype(soft);
+				const Real length = softening.length;
+				vector acc = vector::Zero();
+				size_t count = walk(p, self, limit(previous), [&acc, length](vector d, Real m) { acc += pull<Soft>(d, m, length); });
+				if (interactions) *interactions += count;
+				return acc;
+			});
+		}
+
+		//    (     active)  ax, ay   ,  
+		//  group_size ;   ax, ay -     .
+		//    
+		size_t accelerations(Real* ax, Real* ay, const std::vector<uint32_t>* active = nullptr) const {
+			if (m_count == 0 || m_root == no_root) return 0;
+			const uint32_t limit = uint32_t(std::clamp(group_size, 1, max_group));
+			std::vector<uint8_t> wanted;
+			if (active) {
+				wanted.assign(m_count, 0);
+				for (uint32_t a : *active) if (a < m_count) wanted[a] = 1;
+			}
+			//  :     ,      limit
+			std::vector<int> groups, stack(1, m_root);
+			while (!stack.empty()) {
+				const int ni = stack.back();
+				stack.pop_back();
+				if (ni < 0 || m_nodes[ni].count <= limit) groups.push_back(ni);
+				else for (int c = 1; c >= 0; c--) stack.push_back(m_nodes[ni].child[c]);
+			}
+
+			//     ,     
+			constexpr size_t chunk = 16;
+			const size_t chunks = ( groups.size() + chunk - 1 ) / chunk;
+			std::vector<size_t> counts(chunks, 0);
+			with_softening(softening.model, [&](auto soft) {
+				using Soft = decltype(soft);
+				GroupKernel kernel = nullptr;
+				if constexpr (std::same_as<Real, float>) kernel = group_kernel(active_simd, softening.model);
+				parallel_for(chunks, 1, [&](size_t c) {
+					group_list list;
+					for (size_t g = c * chunk; g < std::min(groups.size(), ( c + 1 ) * chunk); g++) {
+						if (!gather(groups[g], active ? wanted.data() : nullptr, ax, ay, list)) continue;
+						const size_t sources = interaction_list(list);
+						const size_t t = list.targets.size();
+						if constexpr (std::same_as<Real, float>)
+							kernel(list.x.data(), list.y.data(), list.m.data(), sources, list.px.data(), list.py.data(), t, softening.length, list.ax.data(), list.ay.data());
+						else group_rows<Soft, Real>(list.x.data(), list.y.data(), list.m.data(), sources, list.px.data(), list.py.data(), t, softening.length, list.ax.data(), list.ay.data());
+						for (size_t k = 0; k < t; k++) {
+							const uint32_t b = list.targets[k];
+							ax[b] = list.ax[k];
+							ay[b] = list.ay[k];
+							//      ,    
+							counts[c] += sources - ( m_leaves[b].mass != 0.0f );
+						}
+					}
+				});
+			});
+			size_t total = 0;
+			for (size_t c : counts) total += c;
+			return total;
+		}
+
+		//    p       ,     ( self )
+		Real potential(vector p, int self = -1) const {
+			return with_softening(softening.model, [&](auto soft) {
+				using Soft = decltype(soft);
+				const Real length = softening.length;
+				Real phi = 0;
+				walk(p, self, Real(0), [&phi, length](vector d, Real m) { phi += m * Soft::potential(d.sqrlen(), length); });
+				return Real(G) * phi;
+			});
+		}
+
+		//   m,    d
+		template<typename Soft>
+		static vector pull(vector d, Real m, Real length) {
+			return d * ( Real(G) * m * Soft::inv_cube(d.sqrlen(), length) );
+		}
+
+	private:
+		// 32   ,  32          
+		static constexpr int max_chained = 32;
+		static constexpr int max_depth = 64 + max_chained + 1;
+		//          : ,   ,
+		//    .    ,        ,
+		//   :  1/8     10% ,    
+		static constexpr double margin = 1.0 / 64;
+
+		//  ;    c >= 0 -  , c < 0 -   ~c
+		struct node
+		{
+			vector mass_center = vector::Zero();
+			Real mass = 0;
+			vector lo = vector::Zero(), hi = vector::Zero();	//   
+			Real cell = 0;	//   ,    
+			Real size = 0;	//    :    ,     
+			int child[2] = { -1, -1 };
+			uint32_t count = 0;	//   
+			uint32_t key = 0;	//     ,      prefix 
+			int prefix = 0;
+		};
+
+		struct leaf_data
+		{
+			vector position = vector::Zero();
+			Real mass = 0;
+		};
+
+		//   ,      ;       16
+		struct group_list
+		{
+			std::vector<uint32_t> targets;
+			std::vector<Real> px, py, ax, ay;
+			std::vector<Real> x, y, m;
+			vector lo, hi;
+			Real limit = 0;	//      
+		};
+
+		std::vector<node> m_nodes;
+		std::vector<int> m_parent;			//   , -1  
+		std::vector<int> m_free;			//   
+		std::vector<leaf_data> m_leaves;	//   
+		std::vector<int> m_leaf_parent;
+		std::vector<uint8_t> m_leaf_prefix;	//  :       
+		std::vector<uint32_t> m_keys;		//     m_square
+		std::vector<uint32_t> m_codes, m_order, m_arrivals;
+		std::vector<uint8_t> m_moved;
+		MortonSquare<Real> m_square;
+		int m_root = no_root;
+		size_t m_count = 0;		//  [0, m_count) -  
+		int m_chained = 0;		//      
+		bool m_valid = false;	//    
+
+		static constexpr int no_root = std::numeric_limits<int>::min();
+
+		static int leaf(int b) noexcept { return ~b; }
+
+		void set_parent(int c, int parent) noexcept {
+			if (c >= 0) m_parent[c] = parent;
+			else {
+				m_leaf_parent[~c] = parent;
+				m_leaf_prefix[~c] = uint8_t(parent >= 0 ? m_nodes[parent].prefix : 0);
+			}
+		}
+
+		//   :  ,  M l^2 <= limit * d^4; 0 -  theta
+		Real limit(Real previous) const {
+			return criterion == opening::relative ? Real(tolerance) * previous / Real(G) : Real(0);
+		}
+
+		//   mass   size    d2   
+		bool distant(Real mass, Real size, Real d2, Real limit) const {
+			if (limit > 0) return mass * size * size <= limit * d2 * d2;
+			return size * size < Real(theta) * Real(theta) * d2;
+		}
+
+		// visit(d, m)      ,   ;    
+		template<typename Visit>
+		size_t walk(vector p, int self, Real limit, Visit&& visit) const {
+			if (m_count == 0 || m_root == no_root) return 0;
+			size_t count = 0;
+
+			int stack[3 * max_depth + 1];
+			int top = 0;
+			stack[top++] = m_root;
+			while (top > 0) {
+				const int ni = stack[--top];
+				if (ni < 0) {
+					const leaf_data& l = m_leaves[~ni];
+					if (~ni != self && l.mass != 0.0f) {
+						visit(l.position - p, l.mass);
+						count++;
+					}
+					continue;
+				}
+				const node& n = m_nodes[ni];
+				if (n.mass == 0.0f) continue;
+				vector d = n.mass_center - p;
+				Real size = n.size;
+				//          ,       
+				bool inside = p.x >= n.lo.x && p.x <= n.hi.x && p.y >= n.lo.y && p.y <= n.hi.y;
+				if (!inside && distant(n.mass, size, d.sqrlen(), limit)) {
+					visit(d, n.mass);
+					count++;
+				}
+				//        :    ,
+				//      
+				else for (int c = 1; c >= 0; c--) {
+					const int ci = n.child[c];
+					if (ci >= 0 && m_nodes[ci].cell == n.cell) {
+						stack[top++] = m_nodes[ci].child[1];
+						stack[top++] = m_nodes[ci].child[0];
+					}
+					else stack[top++] = ci;
+				}
+			}
+			return count;
+		}
+
+		//   root (   wanted,   ),      
+		//    ax, ay; false -  
+		bool gather(int root, const uint8_t* wanted, const Real* ax, const Real* ay, group_list& list) const {
+			Real previous = std::numeric_limits<Real>::max();
+			list.targets.clear();
+			list.px.clear();
+			list.py.clear();
+			int stack[max_depth + 1];
+			int top = 0;
+			stack[top++] = root;
+			while (top > 0) {
+				const int ni = stack[--top];
+				if (ni >= 0) {
+					stack[top++] = m_nodes[ni].child[1];
+					stack[top++] = m_nodes[ni].child[0];
+					continue;
+				}
+				if (wanted && !wanted[~ni]) continue;
+				const vector p = m_leaves[~ni].position;
+				list.lo = list.targets.empty() ? p : vector::Min(list.lo, p);
+				list.hi = list.targets.empty() ? p : vector::Max(list.hi, p);
+				previous = std::min(previous, std::hypot(ax[~ni], ay[~ni]));
+				list.targets.push_back(uint32_t(~ni));
+				list.px.push_back(p.x);
+				list.py.push_back(p.y);
+			}
+			list.ax.resize(list.targets.size());
+			list.ay.resize(list.targets.size());
+			list.limit = limit(previous);
+			return !list.targets.empty();
+		}
+
+		//      :  ,          
+		//        ,       ;
+		//     
+		size_t interaction_list(group_list& list) const {
+			list.x.clear();
+			list.y.clear();
+			list.m.clear();
+			auto add = [&list](vector p, Real m) {
+				list.x.push_back(p.x);
+				list.y.push_back(p.y);
+				list.m.push_back(m);
+			};
+			const vector lo = list.lo, hi = list.hi;
+			int stack[3 * max_depth + 1];
+			int top = 0;
+			stack[top++] = m_root;
+			while (top > 0) {
+				const int ni = stack[--top];
+				if (ni < 0) {
+					const leaf_data& l = m_leaves[~ni];
+					if (l.mass != 0.0f) add(l.position, l.mass);
+					continue;
+				}
+				const node& n = m_nodes[ni];
+				if (n.mass == 0.0f) continue;
+				const bool overlap = n.lo.x <= hi.x && n.hi.x >= lo.x && n.lo.y <= hi.y && n.hi.y >= lo.y;
+				const vector d = vector::Max(vector::Max(lo - n.mass_center, n.mass_center - hi), vector::Zero());
+				if (!overlap && distant(n.mass, n.size, d.sqrlen(), list.limit)) add(n.mass_center, n.mass);
+				else for (int c = 1; c >= 0; c--) {
+					const int ci = n.child[c];
+					if (ci >= 0 && m_nodes[ci].cell == n.cell) {
+						stack[top++] = m_nodes[ci].child[1];
+						stack[top++] = m_nodes[ci].child[0];
+					}
+					else stack[top++] = ci;
+				}
+			}
+			const size_t sources = list.m.size();
+			list.x.resize(( sources + 15 ) & ~size_t(15), Real(0));
+			list.y.resize(list.x.size(), Real(0));
+			list.m.resize(list.x.size(), Real(0));
+			return sources;
+		}
+
+		//     i  j;    ,    
+		int prefix(int i, int j) const noexcept {
+			const int n = int(m_codes.size());
+			if (j < 0 || j >= n) return -1;
+			if (m_codes[i] == m_codes[j]) return 32 + std::countl_zero(uint32_t(i ^ j));
+			return std::countl_zero(m_codes[i] ^ m_codes[j]);
+		}
+
+		static int common(uint32_t a, uint32_t b) noexcept {
+			return a == b ? 32 : std::countl_zero(a ^ b);
+		}
+
+		static int bit(uint32_t code, int i) noexcept {
+			return int(( code >> ( 31 - i ) ) & 1);
+		}
+
+		Real cell(int prefix) const {
+			return std::ldexp(m_square.side, -std::min(prefix, 32) / 2);
+		}
+
+		//   i:  ,   i -   ,    (Karras 2012)
+		void link(int i) {
+			const int d = prefix(i, i + 1) > prefix(i, i - 1) ? 1 : -1;
+			const int lower = prefix(i, i - d);
+			int reach = 2;
+			while (prefix(i, i + reach * d) > lower) reach *= 2;
+			int length = 0;
+			for (int t = reach / 2; t >= 1; t /= 2)
+				if (prefix(i, i + ( length + t ) * d) > lower) length += t;
+			const int j = i + length * d;
+
+			const int common = prefix(i, j);
+			int split = 0;
+			for (int t = length; t > 1; ) {
+				t = ( t + 1 ) / 2;
+				if (prefix(i, i + ( split + t ) * d) > common) split += t;
+			}
+			const int gamma = i + split * d + std::min(d, 0);
+
+			const int left = std::min(i, j) == gamma ? leaf(int(m_order[gamma])) : gamma;
+			const int right = std::max(i, j) == gamma + 1 ? leaf(int(m_order[gamma + 1])) : gamma + 1;
+			node& n = m_nodes[i];
+			n.key = m_codes[i];
+			n.prefix = common;
+			n.cell = cell(common);
+			n.child[0] = left;
+			n.child[1] = right;
+			set_parent(left, i);
+			set_parent(right, i);
+		}
+
+		//       ; ,     ,   
+		//  . false -    :    ,    
+		//       
+		bool reinsert(const BasicBodySystem<Real>& bodies) {
+			const size_t n = bodies.size(), old = m_count;
+			const Real* x = bodies.x(), * y = bodies.y();
+			m_moved.assign(n, 0);
+			std::atomic<size_t> moved = n - old;
+			std::atomic<bool> escaped = false;
+			parallel_for(old, [&](size_t b) {
+				if (!m_square.contains(x[b], y[b])) {
+					escaped.store(true, std::memory_order_relaxed);
+					return;
+				}
+				const uint32_t code = m_square.code(x[b], y[b]);
+				if (code == m_keys[b] || m_leaf_parent[b] < 0 || near(code, m_keys[b], m_leaf_prefix[b])) return;
+				m_keys[b] = code;
+				m_moved[b] = 1;
+				moved.fetch_add(1, std::memory_order_relaxed);
+			});
+			if (escaped || double(moved) > double(rebuild_fraction) * double(n)) return false;
+			for (size_t b = old; b < n; b++)
+				if (!m_square.contains(x[b], y[b])) return false;
+
+			//     ,  :   -  
+			m_leaf_parent.resize(n, -1);
+			m_leaf_prefix.resize(n);
+			m_leaves.resize(n);
+			m_keys.resize(n);
+			for (size_t b = old; b < n; b++) {
+				m_keys[b] = m_square.code(x[b], y[b]);
+				m_moved[b] = 1;
+				m_free.push_back(int(m_nodes.size()));
+				m_nodes.emplace_back();
+				m_parent.push_back(-1);
+			}
+			for (size_t b = 0; b < old; b++)
+				if (m_moved[b]) remove(int(b));
+			m_count = n;
+			for (size_t b = 0; b < n; b++)
+				if (m_moved[b] && !insert(int(b))) return false;
+			return true;
+		}
+
+		//    code         key   prefix (  
+		//  - ).      ,        
+		// ,   ,       ,        
+		static bool near(uint32_t code, uint32_t key, int prefix) noexcept {
+			const int level = std::min(prefix / 2, 15), fine = std::min(2, 16 - level);
+			const int shift = 16 - level - fine, span = 1 << fine;	//      
+			auto close = [shift, fine, span](uint32_t a, uint32_t k) {
+				const int d = int(a >> shift) - span * int(k >> ( shift + fine ));
+				return d >= -1 && d <= span;
+			};
+			return close(compact_bits(code), compact_bits(key)) && close(compact_bits(code >> 1), compact_bits(key >> 1));
+		}
+
+		void remove(int b) {
+			const int pi = m_leaf_parent[b];
+			m_leaf_parent[b] = -1;
+			if (pi < 0) {
+				m_root = no_root;
+				return;
+			}
+			const node& p = m_nodes[pi];
+			const int sibling = p.child[p.child[0] == leaf(b)];
+			const int grand = m_parent[pi];
+			if (grand < 0) m_root = sibling;
+			else m_nodes[grand].child[m_nodes[grand].child[1] == pi] = sibling;
+			set_parent(sibling, grand);
+			m_free.push_back(pi);
+		}
+
+		//     ,        ,     
+		bool insert(int b) {
+			const uint32_t code = m_keys[b];
+			if (m_root == no_root) {
+				m_root = leaf(b);
+				m_leaf_parent[b] = -1;
+				return true;
+			}
+			int parent = -1, side = 0, at = m_root, split;
+			while (true) {
+				if (at < 0) {
+					split = common(code, m_keys[~at]);
+					break;
+				}
+				const node& n = m_nodes[at];
+				split = common(code, n.key);
+				//      -        
+				if (split < n.prefix || n.prefix >= 32) break;
+				parent = at;
+				side = bit(code, n.prefix);
+				at = n.child[side];
+			}
+			//       ,   
+			if (split >= 32 && ++m_chained > max_chained) return false;
+
+			const int ni = m_free.back();
+			m_free.pop_back();
+			node& n = m_nodes[ni];
+			n.key = code;
+			n.prefix = split;
+			n.cell = cell(split);
+			const int own = split < 32 ? bit(code, split) : 1;
+			n.child[own] = leaf(b);
+			n.child[1 - own] = at;
+			set_parent(leaf(b), ni);
+			set_parent(at, ni);
+			m_parent[ni] = parent;
+			if (parent < 0) m_root = ni;
+			else m_nodes[parent].child[side] = ni;
+			return true;
+		}
+
+		//     ,   -  ,     :
+		//        ,  
+		void aggregate(const BasicBodySystem<Real>& bodies) {
+			m_arrivals.assign(m_nodes.size(), 0);
+			parallel_for(m_count, [&](size_t b) {
+				m_leaves[b] = { bodies.position(b), bodies.mass()[b] };
+				for (int ni = m_leaf_parent[b]; ni >= 0; ni = m_parent[ni]) {
+					if (std::atomic_ref<uint32_t>(m_arrivals[ni]).fetch_add(1, std::memory_order_acq_rel) == 0) break;
+					combine(ni);
+				}
+			});
+		}
+
+		void combine(int ni) {
+			node& n = m_nodes[ni];
+			Real mass = 0;
+			uint32_t count = 0;
+			vector moment = vector::Zero(), lo, hi;
+			for (int c = 0; c < 2; c++) {
+				const int ci = n.child[c];
+				vector center, clo, chi;
+				Real m;
+				if (ci < 0) {
+					center = clo = chi = m_leaves[~ci].position;
+					m = m_leaves[~ci].mass;
+					count++;
+				}
+				else {
+					center = m_nodes[ci].mass_center;
+					clo = m_nodes[ci].lo;
+					chi = m_nodes[ci].hi;
+					m = m_nodes[ci].mass;
+					count += m_nodes[ci].count;
+				}
+				mass += m;
+				moment += center * m;
+				lo = c == 0 ? clo : vector::Min(lo, clo);
+				hi = c == 0 ? chi : vector::Max(hi, chi);
+			}
+			n.mass = mass;
+			n.count = count;
+			n.mass_center = mass > 0 ? moment / mass : ( lo + hi ) * Real(0.5);
+			n.lo = lo;
+			n.hi = hi;
+			n.size = std::max(n.cell, ( hi - lo ).max());
+		}
+	};
+
+	using QuadTree = BasicQuadTree<float>;
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#pragma once
+#include <algorithm>
+#include <concepts>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include "body_system.h"
+#include "index_map.h"
+#include "integrator.h"
+
+namespace grav
+{
+	//  :   k   dt = h / 2^k,    
+	//   ,     ;  kick-drift-kick
+	template<std::floating_point Real>
+	class BasicBlockTimesteps {
+	public:
+		//    h / 2^max_level
+		int max_level = 6;
+		// : dt = eta * |a| / |da/dt|
+		float eta = 0.05f;
+
+		void invalidate() noexcept { m_valid = false; }
+
+		//    ;       ,
+		//    
+		void remap(const IndexMap& map, size_t new_size) {
+			if (m_count == map.old_size()) m_count = new_size;
+			std::vector<uint8_t> touched(new_size, 0);
+			if (!map.identity())
+				for (size_t i = 0; i < map.old_size(); i++) if (!map.survives(int(i))) touched[map(int(i))] = 1;
+			map.apply(m_level, new_size, uint8_t(max_level));
+			map.apply(m_history, new_size, uint8_t(0));
+			map.apply(m_ax_prev, new_size, Real(0));
+			map.apply(m_ay_prev, new_size, Real(0));
+			for (size_t i = 0; i < new_size; i++) if (touched[i]) {
+				m_level[i] = uint8_t(max_level);
+				m_history[i] = 0;
+			}
+		}
+
+		//        
+		size_t evaluations() const noexcept { return m_evaluations; }
+		//        
+		size_t global_evaluations() const noexcept { return m_global; }
+
+		// compute(active)  ax, ay     active     
+		template<typename Forces>
+		void step(BasicBodySystem<Real>& bodies, Real h, Forces&& compute) {
+			const size_t n = bodies.size();
+			const int top = std::clamp(max_level, 0, 20);
+			m_level.resize(n, uint8_t(top));
+			m_history.resize(n, 0);
+			m_ax_prev.resize(n, Real(0));
+			m_ay_prev.resize(n, Real(0));
+			for (uint8_t& l : m_level) l = uint8_t(std::min<int>(l, top));
+
+			m_evaluations = 0;
+			if (!m_valid || m_count != n) {
+				m_active.resize(n);
+				for (uint32_t i = 0; i < n; i++) m_active[i] = i;
+				compute(m_active);
+				m_evaluations += n;
+			}
+
+			const uint32_t substeps = 1u << top;
+			const Real tau = h / Real(substeps);
+			const Real* ax = bodies.ax(), * ay = bodies.ay();
+			auto dt = [h](int level) { return h / Real(1u << level); };
+
+			//  - 
+			for (size_t i = 0; i < n; i++) BasicIntegrator<Real>::kick(bodies, i, Real(0.5) * dt(m_level[i]));
+
+			for (uint32_t t = 1; t <= substeps; t++) {
+				BasicIntegrator<Real>::drift(bodies, tau);
+				m_active.clear();
+				for (uint32_t i = 0; i < n; i++) if (t % ( 1u << ( top - m_level[i] ) ) == 0) m_active.push_back(i);
+				if (m_active.empty()) continue;
+				compute(m_active);
+				m_evaluations += m_active.size();
+
+				for (uint32_t i : m_active) {
+					Real step = dt(m_level[i]);
+					BasicIntegrator<Real>::kick(bodies, i, Real(0.5) * step);
+
+					int level = m_level[i];
+					if (m_history[i]) {
+						//         
+						Real jx = ( ax[i] - m_ax_prev[i] ) / step, jy = ( ay[i] - m_ay_prev[i] ) / step;
+						Real a = std::sqrt(ax[i] * ax[i] + ay[i] * ay[i]), j = std::sqrt(jx * jx + jy * jy);
+						Real wanted = j > 0 ? eta * a / j : h;
+						level = wanted >= h ? 0 : std::min(top, int(std::ceil(std::log2(h / wanted))));
+					}
+					//     ,      
+					while (t % ( 1u << ( top - level ) ) != 0) level++;
+					m_level[i] = uint8_t(level);
+					m_history[i] = 1;
+					m_ax_prev[i] = ax[i];
+					m_ay_prev[i] = ay[i];
+
+					if (t < substeps) BasicIntegrator<Real>::kick(bodies, i, Real(0.5) * dt(level));
+				}
+			}
+
+			m_global = n * substeps;
+			m_valid = true;
+			m_count = n;
+		}
+
+	private:
+		bool m_valid = false;
+		size_t m_count = 0;
+		size_t m_evaluations = 0, m_global = 0;
+		std::vector<uint8_t> m_level, m_history;
+		std::vector<Real> m_ax_prev, m_ay_prev;
+		std::vector<uint32_t> m_active;
+	};
+
+	using BlockTimesteps = BasicBlockTimesteps<float>;
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+#include <EvoNDZ/math/vector2.h>
+#include <concepts>
+#include <cmath>
+
+const float G = 0.01f;
+
+template<std::floating_point T>
+struct basic_body
+{
+	evo::Vector2<T> position;
+	evo::Vector2<T> velocity = evo::Vector2<T>(0, 0);
+	T mass;
+	T r;
+	//         
+	basic_body(evo::Vector2<T> pos, T received_mass) { position = pos; mass = received_mass; r = sqrt(mass) * 0.01; }
+	//      
+	template<std::floating_point U>
+	explicit basic_body(const basic_body<U>& b)
+		: position(T(b.position.x), T(b.position.y)), velocity(T(b.velocity.x), T(b.velocity.y)), mass(T(b.mass)), r(T(b.r)) { }
+};
+
+using body = basic_body<float>;
\ No newline at end of file
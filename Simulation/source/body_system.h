@@ -0,0 +1,334 @@
+#pragma once
+#include <EvoNDZ/math/vector2.h>
+#include <algorithm>
+#include <concepts>
+#include <array>
+#include <iterator>
+#include <type_traits>
+#include <initializer_list>
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include "body.h"
+
+namespace grav
+{
+	//  ,    Align 
+	template<typename T, size_t Align>
+	struct AlignedAllocator {
+		using value_type = T;
+
+		template<typename U>
+		struct rebind { using other = AlignedAllocator<U, Align>; };
+
+		AlignedAllocator() noexcept = default;
+		template<typename U>
+		AlignedAllocator(const AlignedAllocator<U, Align>&) noexcept { }
+
+		T* allocate(size_t n) {
+			return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Align)));
+		}
+		void deallocate(T* p, size_t) noexcept {
+			::operator delete(p, std::align_val_t(Align));
+		}
+
+		template<typename U>
+		bool operator==(const AlignedAllocator<U, Align>&) const noexcept { return true; }
+	};
+
+	//    x  y,    ;    evo::Vector2
+	template<std::floating_point Real>
+	struct BasicVectorRef {
+		Real& x;
+		Real& y;
+
+		operator evo::Vector2<Real>() const noexcept { return evo::Vector2<Real>(x, y); }
+		evo::Vector2<Real> get() const noexcept { return evo::Vector2<Real>(x, y); }
+
+		BasicVectorRef& operator=(const BasicVectorRef& v) noexcept { x = v.x; y = v.y; return *this; }
+		BasicVectorRef& operator=(evo::Vector2<Real> v) noexcept { x = v.x; y = v.y; return *this; }
+		BasicVectorRef& operator+=(evo::Vector2<Real> v) noexcept { x += v.x; y += v.y; return *this; }
+		BasicVectorRef& operator-=(evo::Vector2<Real> v) noexcept { x -= v.x; y -= v.y; return *this; }
+		BasicVectorRef& operator*=(Real k) noexcept { x *= k; y *= k; return *this; }
+
+		Real length() const { return get().length(); }
+		Real sqrlen() const { return x * x + y * y; }
+	};
+
+	using VectorRef = BasicVectorRef<float>;
+
+	template<typename T>
+	struct vector_scalar { };
+	template<typename Real>
+	struct vector_scalar<BasicVectorRef<Real>> { using type = Real; };
+	template<typename Real>
+	struct vector_scalar<evo::Vector2<Real>> { using type = Real; };
+
+	template<typename T>
+	concept VectorLike = requires { typename vector_scalar<T>::type; };
+
+	template<typename L, typename R>
+	concept VectorPair = VectorLike<L> && VectorLike<R> && std::same_as<typename vector_scalar<L>::type, typename vector_scalar<R>::type>
+		&& ( !std::same_as<L, evo::Vector2<typename vector_scalar<L>::type>> || !std::same_as<R, evo::Vector2<typename vector_scalar<R>::type>> );
+
+	template<VectorLike L, VectorLike R> requires VectorPair<L, R>
+	inline auto operator+(const L& l, const R& r) noexcept {
+		using V = evo::Vector2<typename vector_scalar<L>::type>;
+		return V(l) + V(r);
+	}
+	template<VectorLike L, VectorLike R> requires VectorPair<L, R>
+	inline auto operator-(const L& l, const R& r) noexcept {
+		using V = evo::Vector2<typename vector_scalar<L>::type>;
+		return V(l) - V(r);
+	}
+	template<typename Real>
+	inline evo::Vector2<Real> operator-(const BasicVectorRef<Real>& v) noexcept { return -v.get(); }
+	template<typename Real>
+	inline evo::Vector2<Real> operator*(const BasicVectorRef<Real>& v, std::type_identity_t<Real> k) noexcept { return v.get() * k; }
+	template<typename Real>
+	inline evo::Vector2<Real> operator*(std::type_identity_t<Real> k, const BasicVectorRef<Real>& v) noexcept { return v.get() * k; }
+	template<typename Real>
+	inline evo::Vector2<Real> operator/(const BasicVectorRef<Real>& v, std::type_identity_t<Real> k) noexcept { return v.get() / k; }
+
+	//      BasicBodySystem
+	template<std::floating_point Real>
+	struct BasicBodyRef {
+		BasicVectorRef<Real> position;
+		BasicVectorRef<Real> velocity;
+		Real& mass;
+		Real& r;
+
+		operator basic_body<Real>() const {
+			basic_body<Real> b(position, mass);
+			b.velocity = velocity;
+			b.r = r;
+			return b;
+		}
+	};
+
+	using BodyRef = BasicBodyRef<float>;
+
+	// hi + lo += d    : lo  ,      hi
+	template<std::floating_point Real>
+	inline void compensated_add(Real& hi, Real& lo, Real d) noexcept {
+		Real y = d + lo;
+		Real t = hi + y;
+		lo = y - ( t - hi );
+		hi = t;
+	}
+
+	//     :       ,
+	//      SIMD   (   );
+	// Real -   : float  SIMD-  double   
+	template<std::floating_point Real>
+	class BasicBodySystem {
+	public:
+		using real = Real;
+		static constexpr size_t simd_width = 16;
+		static constexpr size_t alignment = simd_width * sizeof(Real);
+		using array = std::vector<Real, AlignedAllocator<Real, alignment>>;
+		using body_type = basic_body<Real>;
+		using vector_type = evo::Vector2<Real>;
+
+		template<bool Const>
+		class iterator_impl {
+		public:
+			using system_type = std::conditional_t<Const, const BasicBodySystem, BasicBodySystem>;
+			using difference_type = std::ptrdiff_t;
+			using value_type = body_type;
+			using reference = std::conditional_t<Const, body_type, BasicBodyRef<Real>>;
+			using iterator_category = std::random_access_iterator_tag;
+
+			iterator_impl() = default;
+			iterator_impl(system_type* s, size_t i) : m_system(s), m_index(i) { }
+
+			reference operator*() const { return ( *m_system )[m_index]; }
+			reference operator[](difference_type d) const { return ( *m_system )[m_index + d]; }
+			size_t index() const noexcept { return m_index; }
+
+			iterator_impl& operator++() { ++m_index; return *this; }
+			iterator_impl operator++(int) { auto it = *this; ++m_index; return it; }
+			iterator_impl& operator--() { --m_index; return *this; }
+			iterator_impl operator--(int) { auto it = *this; --m_index; return it; }
+			iterator_impl& operator+=(difference_type d) { m_index += d; return *this; }
+			iterator_impl& operator-=(difference_type d) { m_index -= d; return *this; }
+			iterator_impl operator+(difference_type d) const { return iterator_impl(m_system, m_index + d); }
+			iterator_impl operator-(difference_type d) const { return iterator_impl(m_system, m_index - d); }
+			difference_type operator-(const iterator_impl& it) const { return difference_type(m_index) - difference_type(it.m_index); }
+
+			bool operator==(const iterator_impl& it) const noexcept { return m_index == it.m_index; }
+			auto operator<=>(const iterator_impl& it) const noexcept { return m_index <=> it.m_index; }
+
+		private:
+			system_type* m_system = nullptr;
+			size_t m_index = 0;
+		};
+
+		using iterator = iterator_impl<false>;
+		using const_iterator = iterator_impl<true>;
+
+		size_t size() const noexcept { return m_size; }
+		bool empty() const noexcept { return m_size == 0; }
+		//        SIMD
+		size_t padded_size() const noexcept { return m_x.size(); }
+
+		BasicBodyRef<Real> operator[](size_t i) noexcept {
+			return BasicBodyRef<Real> { { m_x[i], m_y[i] }, { m_vx[i], m_vy[i] }, m_mass[i], m_r[i] };
+		}
+		body_type operator[](size_t i) const {
+			body_type b(vector_type(m_x[i], m_y[i]), m_mass[i]);
+			b.velocity = vector_type(m_vx[i], m_vy[i]);
+			b.r = m_r[i];
+			return b;
+		}
+
+		iterator begin() noexcept { return iterator(this, 0); }
+		iterator end() noexcept { return iterator(this, m_size); }
+		const_iterator begin() const noexcept { return const_iterator(this, 0); }
+		const_iterator end() const noexcept { return const_iterator(this, m_size); }
+
+		void push_back(const body_type& b) {
+			if (m_size == padded_size()) resize_storage(m_size + simd_width);
+			m_x[m_size] = b.position.x;
+			m_y[m_size] = b.position.y;
+			m_vx[m_size] = b.velocity.x;
+			m_vy[m_size] = b.velocity.y;
+			m_mass[m_size] = b.mass;
+			m_r[m_size] = b.r;
+			m_size++;
+		}
+		void emplace_back(vector_type pos, Real mass) {
+			push_back(body_type(pos, mass));
+		}
+
+		//     keep[i] == 0   ; remap[ ] =    -1
+		void compact(const std::vector<uint8_t>& keep, std::vector<int>& remap) {
+			remap.assign(m_size, -1);
+			size_t w = 0;
+			for (size_t i = 0; i < m_size; i++) {
+				if (!keep[i]) continue;
+				remap[i] = int(w);
+				if (w != i) for (array* a : arrays()) ( *a )[w] = ( *a )[i];
+				w++;
+			}
+			for (array* a : arrays()) std::fill(a->begin() + w, a->begin() + m_size, Real(0));
+			m_size = w;
+		}
+
+		//  :   i -   order[i]
+		void permute(const std::vector<uint32_t>& order) {
+			//      ,        
+			array moved(padded_size(), Real(0));
+			for (array* a : arrays()) {
+				for (size_t i = 0; i < m_size; i++) moved[i] = ( *a )[order[i]];
+				a->swap(moved);
+			}
+		}
+
+		//     (  )
+		template<std::floating_point Other>
+		void assign(const BasicBodySystem<Other>& other) {
+			m_size = other.size();
+			resize_storage(other.padded_size());
+			auto copy = [this](array& to, const Other* from) {
+				std::copy(from, from + m_size, to.begin());
+				std::fill(to.begin() + m_size, to.end(), Real(0));
+			};
+			copy(m_x, other.x());
+			copy(m_y, other.y());
+			copy(m_vx, other.vx());
+			copy(m_vy, other.vy());
+			copy(m_mass, other.mass());
+			copy(m_r, other.r());
+			copy(m_ax, other.ax());
+			copy(m_ay, other.ay());
+			if (m_compensated) for (array* a : { &m_x_lo, &m_y_lo, &m_vx_lo, &m_vy_lo }) std::fill(a->begin(), a->end(), Real(0));
+		}
+
+		void clear() noexcept {
+			for (array* a : arrays()) std::fill(a->begin(), a->end(), Real(0));
+			m_size = 0;
+		}
+		void shrink_to_fit() {
+			resize_storage(( m_size + simd_width - 1 ) / simd_width * simd_width);
+			for (array* a : arrays()) a->shrink_to_fit();
+		}
+
+		//  :       ,  
+		//   ,    ;  -    
+		bool compensated() const noexcept { return m_compensated; }
+		void set_compensated(bool on) {
+			if (on == m_compensated) return;
+			if (!on)
+				for (size_t i = 0; i < m_size; i++) {
+					m_x[i] += m_x_lo[i];
+					m_y[i] += m_y_lo[i];
+					m_vx[i] += m_vx_lo[i];
+					m_vy[i] += m_vy_lo[i];
+				}
+			for (array* a : { &m_x_lo, &m_y_lo, &m_vx_lo, &m_vy_lo }) {
+				if (on) a->assign(padded_size(), Real(0));
+				else array().swap(*a);
+			}
+			m_compensated = on;
+		}
+
+		Real* x() noexcept { return m_x.data(); }
+		Real* y() noexcept { return m_y.data(); }
+		Real* vx() noexcept { return m_vx.data(); }
+		Real* vy() noexcept { return m_vy.data(); }
+		Real* mass() noexcept { return m_mass.data(); }
+		Real* r() noexcept { return m_r.data(); }
+		const Real* x() const noexcept { return m_x.data(); }
+		const Real* y() const noexcept { return m_y.data(); }
+		const Real* vx() const noexcept { return m_vx.data(); }
+		const Real* vy() const noexcept { return m_vy.data(); }
+		const Real* mass() const noexcept { return m_mass.data(); }
+		const Real* r() const noexcept { return m_r.data(); }
+
+		//  ; ,  compensated() == false
+		Real* x_lo() noexcept { return m_x_lo.data(); }
+		Real* y_lo() noexcept { return m_y_lo.data(); }
+		Real* vx_lo() noexcept { return m_vx_lo.data(); }
+		Real* vy_lo() noexcept { return m_vy_lo.data(); }
+		const Real* x_lo() const noexcept { return m_x_lo.data(); }
+		const Real* y_lo() const noexcept { return m_y_lo.data(); }
+		const Real* vx_lo() const noexcept { return m_vx_lo.data(); }
+		const Real* vy_lo() const noexcept { return m_vy_lo.data(); }
+
+		// ,    
+		Real* ax() noexcept { return m_ax.data(); }
+		Real* ay() noexcept { return m_ay.data(); }
+		const Real* ax() const noexcept { return m_ax.data(); }
+		const Real* ay() const noexcept { return m_ay.data(); }
+
+		vector_type position(size_t i) const noexcept { return vector_type(m_x[i], m_y[i]); }
+		vector_type velocity(size_t i) const noexcept { return vector_type(m_vx[i], m_vy[i]); }
+		vector_type acceleration(size_t i) const noexcept { return vector_type(m_ax[i], m_ay[i]); }
+
+	private:
+		size_t m_size = 0;
+		bool m_compensated = false;
+		array m_x, m_y, m_vx, m_vy, m_mass, m_r, m_ax, m_ay;
+		array m_x_lo, m_y_lo, m_vx_lo, m_vy_lo;
+
+		struct array_list
+		{
+			std::array<array*, 12> items;
+			size_t count;
+
+			array** begin() noexcept { return items.data(); }
+			array** end() noexcept { return items.data() + count; }
+		};
+
+		array_list arrays() noexcept {
+			return { { &m_x, &m_y, &m_vx, &m_vy, &m_mass, &m_r, &m_ax, &m_ay, &m_x_lo, &m_y_lo, &m_vx_lo, &m_vy_lo }, m_compensated ? 12u : 8u };
+		}
+		void resize_storage(size_t n) {
+			for (array* a : arrays()) a->resize(n, Real(0));
+		}
+	};
+
+	using BodySystem = BasicBodySystem<float>;
+}
\ No newline at end of file
@@ -0,0 +1,283 @@
+#pragma once
+#include <EvoNDZ/math/math.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <string_view>
+#include "body_system.h"
+#include "index_map.h"
+#include "parallel.h"
+
+namespace grav
+{
+	//   , a < b
+	using CollisionPair = std::pair<uint32_t, uint32_t>;
+
+	//  -: -        x,   
+	enum class broadphase { hash, sweep };
+
+	inline const char* broadphase_name(broadphase b) {
+		switch (b) {
+		case broadphase::hash: return "hash";
+		case broadphase::sweep: return "sweep";
+		}
+		return "?";
+	}
+
+	inline bool parse_broadphase(std::string_view name, broadphase& b) {
+		for (broadphase c : { broadphase::hash, broadphase::sweep })
+			if (name == broadphase_name(c)) {
+				b = c;
+				return true;
+			}
+		return false;
+	}
+
+	template<typename Real>
+	bool overlap(const Real* x, const Real* y, const Real* r, size_t a, size_t b) noexcept {
+		Real dx = x[a] - x[b], dy = y[a] - y[b];
+		return dx * dx + dy * dy < evo::math::sqr(r[a] + r[b]);
+	}
+
+	//     a  b,        :
+	// 0,    ,  ,    h   
+	template<typename Real>
+	Real impact_time(const BasicBodySystem<Real>& bodies, size_t a, size_t b, Real h) noexcept {
+		const Real* x = bodies.x(), * y = bodies.y(), * vx = bodies.vx(), * vy = bodies.vy(), * r = bodies.r();
+		Real dx = x[b] - x[a], dy = y[b] - y[a], wx = vx[b] - vx[a], wy = vy[b] - vy[a];
+		// |d + w t| = ra + rb: (w.w) t^2 + 2 (d.w) t + (d.d - R^2) = 0
+		Real c = dx * dx + dy * dy - evo::math::sqr(r[a] + r[b]);
+		if (c < 0) return 0;
+		Real bq = dx * wx + dy * wy, aq = wx * wx + wy * wy;
+		Real disc = bq * bq - aq * c;
+		if (bq >= 0 || disc < 0) return std::numeric_limits<Real>::infinity();
+		//        
+		Real t = c / ( std::sqrt(disc) - bq );
+		return t <= h ? t : std::numeric_limits<Real>::infinity();
+	}
+
+	//       h:     x + v t,  r + |v| h / 2.
+	//      ,   ,      
+	//     impact_time
+	struct SweptBounds
+	{
+		std::vector<double> x, y, r;
+
+		template<typename Real>
+		void build(const BasicBodySystem<Real>& bodies, Real h) {
+			const size_t n = bodies.size();
+			x.resize(n);
+			y.resize(n);
+			r.resize(n);
+			for (size_t i = 0; i < n; i++) {
+				double hx = 0.5 * h * bodies.vx()[i], hy = 0.5 * h * bodies.vy()[i];
+				x[i] = bodies.x()[i] + hx;
+				y[i] = bodies.y()[i] + hy;
+				r[i] = bodies.r()[i] + std::sqrt(hx * hx + hy * hy);
+			}
+		}
+	};
+
+	//    -:        
+	//  3x3  ;        
+	class SpatialHash {
+	public:
+		template<typename Real>
+		void find_pairs(const BasicBodySystem<Real>& bodies, std::vector<CollisionPair>& pairs) {
+			search(bodies.x(), bodies.y(), bodies.r(), bodies.size(), pairs, [](size_t, size_t) { return true; });
+		}
+
+		// ,     h ( )
+		template<typename Real>
+		void find_swept_pairs(const BasicBodySystem<Real>& bodies, Real h, std::vector<CollisionPair>& pairs) {
+			m_swept.build(bodies, h);
+			search(m_swept.x.data(), m_swept.y.data(), m_swept.r.data(), bodies.size(), pairs, [&bodies, h](size_t a, size_t b) {
+				return impact_time(bodies, a, b, h) <= h;
+			});
+		}
+
+	private:
+		float m_cell = 1.0f;
+		uint32_t m_mask = 0;
+		std::vector<int32_t> m_cx, m_cy;
+		std::vector<uint32_t> m_bucket, m_start, m_fill, m_sorted, m_large;
+		std::vector<std::vector<CollisionPair>> m_chunk_pairs;
+		SweptBounds m_swept;
+
+		uint32_t hash(int32_t cx, int32_t cy) const noexcept {
+			return ( uint32_t(cx) * 73856093u ^ uint32_t(cy) * 19349663u ) & m_mask;
+		}
+
+		//   (x, y, r),      test(a, b)
+		template<typename Real, typename Test>
+		void search(const Real* x, const Real* y, const Real* r, size_t n, std::vector<CollisionPair>& pairs, Test&& test) {
+			pairs.clear();
+			if (n < 2) return;
+
+			//     :     ,    -   
+			double sum_r = 0.0;
+			for (size_t i = 0; i < n; i++) sum_r += r[i];
+			m_cell = float(4.0 * sum_r / double(n));
+			if (!( m_cell > 0.0f )) m_cell = 1.0f;
+			const Real inv_cell = Real(1) / m_cell;
+			const Real small_r = m_cell * Real(0.5);
+
+			size_t table = 1;
+			while (table < 2 * n) table <<= 1;
+			m_mask = uint32_t(table - 1);
+
+			m_cx.resize(n);
+			m_cy.resize(n);
+			m_bucket.resize(n);
+			m_large.clear();
+			m_start.assign(table + 1, 0);
+			for (size_t i = 0; i < n; i++) {
+				m_cx[i] = int32_t(std::floor(x[i] * inv_cell));
+				m_cy[i] = int32_t(std::floor(y[i] * inv_cell));
+				if (r[i] > small_r) {
+					m_large.push_back(uint32_t(i));
+					m_bucket[i] = uint32_t(-1);
+					continue;
+				}
+				m_bucket[i] = hash(m_cx[i], m_cy[i]);
+				m_start[m_bucket[i] + 1]++;
+			}
+			for (size_t c = 0; c < table; c++) m_start[c + 1] += m_start[c];
+			m_sorted.resize(m_start[table]);
+			m_fill.assign(m_start.begin(), m_start.end() - 1);
+			for (size_t i = 0; i < n; i++)
+				if (m_bucket[i] != uint32_t(-1)) m_sorted[m_fill[m_bucket[i]]++] = uint32_t(i);
+
+			//     ,        
+			constexpr size_t chunk = 1024;
+			const size_t chunks = ( n + chunk - 1 ) / chunk;
+			m_chunk_pairs.resize(chunks);
+			parallel_for(chunks, [&](size_t c) {
+				std::vector<CollisionPair>& out = m_chunk_pairs[c];
+				out.clear();
+				for (size_t a = c * chunk; a < std::min(n, ( c + 1 ) * chunk); a++) {
+					if (m_bucket[a] == uint32_t(-1)) continue;
+					for (int32_t dy = -1; dy <= 1; dy++) for (int32_t dx = -1; dx <= 1; dx++) {
+						const int32_t cx = m_cx[a] + dx, cy = m_cy[a] + dy;
+						const uint32_t h = hash(cx, cy);
+						for (uint32_t k = m_start[h]; k < m_start[h + 1]; k++) {
+							uint32_t b = m_sorted[k];
+							//          
+							if (b <= a || m_cx[b] != cx || m_cy[b] != cy) continue;
+							if (overlap(x, y, r, a, b) && test(a, b)) out.emplace_back(uint32_t(a), b);
+						}
+					}
+				}
+				//         :   -   ,
+				//    O(L N)       ;    -  
+				if (m_large.empty()) return;
+				for (size_t b = c * chunk; b < std::min(n, ( c + 1 ) * chunk); b++)
+					for (uint32_t l : m_large) {
+						if (b == l || ( r[b] > small_r && b < l )) continue;
+						if (overlap(x, y, r, l, b) && test(l, b)) out.emplace_back(std::min<uint32_t>(l, uint32_t(b)), std::max<uint32_t>(l, uint32_t(b)));
+					}
+			});
+			for (const auto& part : m_chunk_pairs) pairs.insert(pairs.end(), part.begin(), part.end());
+			std::sort(pairs.begin(), pairs.end());
+		}
+	};
+
+	//    (sweep and prune)   x:      x - r,
+	//      ,         x + r.
+	//    :     ,     .
+	//       remap,       
+	class SweepAndPrune {
+	public:
+		template<typename Real>
+		void find_pairs(const BasicBodySystem<Real>& bodies, std::vector<CollisionPair>& pairs) {
+			search(bodies.x(), bodies.y(), bodies.r(), bodies.size(), pairs, [](size_t, size_t) { return true; });
+		}
+
+		// ,     h;   x -  ,     
+		template<typename Real>
+		void find_swept_pairs(const BasicBodySystem<Real>& bodies, Real h, std::vector<CollisionPair>& pairs) {
+			m_swept.build(bodies, h);
+			search(m_swept.x.data(), m_swept.y.data(), m_swept.r.data(), bodies.size(), pairs, [&bodies, h](size_t a, size_t b) {
+				return impact_time(bodies, a, b, h) <= h;
+			});
+		}
+
+		//   (, ):    ,   
+		void remap(const IndexMap& map, size_t new_size) {
+			if (map.identity()) return;
+			size_t w = 0;
+			for (entry e : m_entries) {
+				if (e.body >= map.old_size() || !map.survives(int(e.body))) continue;
+				e.body = uint32_t(map(int(e.body)));
+				m_entries[w++] = e;
+			}
+			m_entries.resize(w);
+			m_count = w;
+			if (w != new_size) reset();
+		}
+
+		void reset() noexcept {
+			m_entries.clear();
+			m_count = 0;
+		}
+
+	private:
+		struct entry
+		{
+			double lo;		//   x - r   
+			uint32_t body;
+		};
+
+		std::vector<entry> m_entries;	//   lo
+		size_t m_count = 0;				//    [0, m_count)
+		std::vector<std::vector<CollisionPair>> m_chunk_pairs;
+		SweptBounds m_swept;
+
+		void insertion_sort() noexcept {
+			for (size_t i = 1; i < m_entries.size(); i++) {
+				entry e = m_entries[i];
+				size_t j = i;
+				for (; j > 0 && m_entries[j - 1].lo > e.lo; j--) m_entries[j] = m_entries[j - 1];
+				m_entries[j] = e;
+			}
+		}
+
+		//   (x, y, r),      test(a, b)
+		template<typename Real, typename Test>
+		void search(const Real* x, const Real* y, const Real* r, size_t n, std::vector<CollisionPair>& pairs, Test&& test) {
+			pairs.clear();
+			//     remap -     
+			if (n < m_count) reset();
+			const size_t added = n - m_count;
+			for (size_t i = m_count; i < n; i++) m_entries.push_back({ 0.0, uint32_t(i) });
+			m_count = n;
+			for (entry& e : m_entries) e.lo = double(x[e.body]) - r[e.body];
+			//        
+			if (added * 8 > n) std::sort(m_entries.begin(), m_entries.end(), [](const entry& a, const entry& b) { return a.lo < b.lo; });
+			else insertion_sort();
+			if (n < 2) return;
+
+			//    ,        
+			constexpr size_t chunk = 1024;
+			const size_t chunks = ( n + chunk - 1 ) / chunk;
+			m_chunk_pairs.resize(chunks);
+			parallel_for(chunks, [&](size_t c) {
+				std::vector<CollisionPair>& out = m_chunk_pairs[c];
+				out.clear();
+				for (size_t k = c * chunk; k < std::min(n, ( c + 1 ) * chunk); k++) {
+					const uint32_t a = m_entries[k].body;
+					const double hi = double(x[a]) + r[a];
+					for (size_t j = k + 1; j < n && m_entries[j].lo <= hi; j++) {
+						const uint32_t b = m_entries[j].body;
+						if (overlap(x, y, r, a, b) && test(a, b)) out.emplace_back(std::min(a, b), std::max(a, b));
+					}
+				}
+			});
+			for (const auto& part : m_chunk_pairs) pairs.insert(pairs.end(), part.begin(), part.end());
+			std::sort(pairs.begin(), pairs.end());
+		}
+	};
+}
\ No newline at end of file
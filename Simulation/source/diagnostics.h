@@ -0,0 +1,169 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include "body.h"
+#include "body_system.h"
+#include "barnes_hut.h"
+#include "parallel.h"
+#include "softening.h"
+
+namespace grav
+{
+	//   ;   ,    motion()
+	template<typename Real>
+	double kinetic_energy(const BasicBodySystem<Real>& bodies) {
+		const bool lo = bodies.compensated();
+		double e = 0.0;
+		for (size_t i = 0; i < bodies.size(); i++) {
+			double vx = bodies.vx()[i], vy = bodies.vy()[i];
+			if (lo) {
+				vx += bodies.vx_lo()[i];
+				vy += bodies.vy_lo()[i];
+			}
+			e += 0.5 * bodies.mass()[i] * ( vx * vx + vy * vy );
+		}
+		return e;
+	}
+
+	//   G m_i m_j phi(r)   ,   O(N^2); phi -   
+	//  ,     (  -1 / r),   ""   .
+	//       ,       ;
+	//    ,   
+	template<typename Real>
+	double potential_energy(const BasicBodySystem<Real>& bodies, const Softening& softening = { softening_model::none }) {
+		const size_t n = bodies.size();
+		const double length = softening.length;
+		std::vector<double> px(n), py(n);
+		for (size_t i = 0; i < n; i++) {
+			px[i] = bodies.x()[i];
+			py[i] = bodies.y()[i];
+			if (bodies.compensated()) {
+				px[i] += bodies.x_lo()[i];
+				py[i] += bodies.y_lo()[i];
+			}
+		}
+		std::vector<double> rows(n, 0.0);
+		with_softening(softening.model, [&](auto soft) {
+			parallel_for(n, [&bodies, &rows, &px, &py, n, length](size_t i) {
+				const Real* m = bodies.mass();
+				double sum = 0.0;
+				for (size_t j = i + 1; j < n; j++) {
+					double dx = px[j] - px[i], dy = py[j] - py[i];
+					sum += m[j] * decltype(soft)::potential(dx * dx + dy * dy, length);
+				}
+				rows[i] = double(G) * m[i] * sum;
+			});
+		});
+		double e = 0.0;
+		for (double r : rows) e += r;
+		return e;
+	}
+
+	template<typename Real>
+	double total_energy(const BasicBodySystem<Real>& bodies, const Softening& softening = { softening_model::none }) {
+		return kinetic_energy(bodies) + potential_energy(bodies, softening);
+	}
+
+	//         : O(N log N)  O(N^2),
+	//     ,     
+	template<typename Real>
+	double potential_energy(const BasicQuadTree<Real>& tree, const BasicBodySystem<Real>& bodies) {
+		const size_t n = bodies.size();
+		std::vector<double> rows(n, 0.0);
+		parallel_for(n, [&tree, &bodies, &rows](size_t i) {
+			rows[i] = 0.5 * double(bodies.mass()[i]) * tree.potential(bodies.position(i), int(i));
+		});
+		double e = 0.0;
+		for (double r : rows) e += r;
+		return e;
+	}
+
+	//      
+	struct ConservedQuantities
+	{
+		size_t step = 0;
+		double kinetic = 0.0, potential = 0.0;
+		double px = 0.0, py = 0.0;			// 
+		double angular = 0.0;				//     
+		double mass = 0.0, cx = 0.0, cy = 0.0;	//    
+
+		double energy() const noexcept { return kinetic + potential; }
+	};
+
+	// ,   ,     ;     
+	template<typename Real>
+	ConservedQuantities motion(const BasicBodySystem<Real>& bodies) {
+		ConservedQuantities q;
+		const bool lo = bodies.compensated();
+		for (size_t i = 0; i < bodies.size(); i++) {
+			double m = bodies.mass()[i];
+			double x = bodies.x()[i], y = bodies.y()[i], vx = bodies.vx()[i], vy = bodies.vy()[i];
+			if (lo) {
+				x += bodies.x_lo()[i];
+				y += bodies.y_lo()[i];
+				vx += bodies.vx_lo()[i];
+				vy += bodies.vy_lo()[i];
+			}
+			q.kinetic += 0.5 * m * ( vx * vx + vy * vy );
+			q.px += m * vx;
+			q.py += m * vy;
+			q.angular += m * ( x * vy - y * vx );
+			q.mass += m;
+			q.cx += m * x;
+			q.cy += m * y;
+		}
+		if (q.mass > 0.0) {
+			q.cx /= q.mass;
+			q.cy /= q.mass;
+		}
+		return q;
+	}
+
+	//    interval ;    reset -   .
+	//   log,       CSV ( -     )
+	class ConservationMonitor {
+	public:
+		int interval = 0;	// 0 -  
+		std::FILE* log = nullptr;
+
+		//  ; true,     
+		bool tick() noexcept { return interval > 0 && ++m_steps % size_t(interval) == 0; }
+		//  tick()   
+		bool due() const noexcept { return interval > 0 && ( m_steps + 1 ) % size_t(interval) == 0; }
+
+		void record(ConservedQuantities q) {
+			q.step = m_steps;
+			if (!m_samples) m_baseline = q;
+			m_last = q;
+			m_samples++;
+			if (log) {
+				if (m_header != log) std::fprintf(log, "step,kinetic,potential,energy,energy_drift,px,py,angular,mass,cx,cy\n");
+				m_header = log;
+				std::fprintf(log, "%zu,%.9e,%.9e,%.9e,%.6e,%.9e,%.9e,%.9e,%.9e,%.9e,%.9e\n", q.step, q.kinetic, q.potential,
+					q.energy(), energy_drift(), q.px, q.py, q.angular, q.mass, q.cx, q.cy);
+				std::fflush(log);
+			}
+		}
+
+		//   :       (, , )
+		void reset() noexcept { m_samples = 0; }
+
+		size_t samples() const noexcept { return m_samples; }
+		const ConservedQuantities& last() const noexcept { return m_last; }
+		const ConservedQuantities& baseline() const noexcept { return m_baseline; }
+
+		//    :  -  |E|,    - 
+		double energy_drift() const noexcept {
+			double e0 = m_baseline.energy();
+			return e0 != 0.0 ? ( m_last.energy() - e0 ) / std::abs(e0) : 0.0;
+		}
+		double momentum_drift() const noexcept { return std::hypot(m_last.px - m_baseline.px, m_last.py - m_baseline.py); }
+		double angular_drift() const noexcept { return m_last.angular - m_baseline.angular; }
+
+	private:
+		size_t m_steps = 0, m_samples = 0;
+		std::FILE* m_header = nullptr;	// ,     
+		ConservedQuantities m_last, m_baseline;
+	};
+}
\ No newline at end of file
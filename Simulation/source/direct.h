@@ -0,0 +1,112 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <type_traits>
+#include <vector>
+#include <cstdint>
+#include "body_system.h"
+#include "gravity_kernels.h"
+#include "parallel.h"
+
+namespace grav
+{
+	//     :  float - SIMD  ,  double - 
+	template<typename Real>
+	inline auto direct_rows_kernel(softening_model model) {
+		if constexpr (std::is_same_v<Real, float>) return direct_kernel(active_simd, model);
+		else return with_softening(model, [](auto soft) { return &direct_rows<decltype(soft), Real>; });
+	}
+
+	template<typename Real>
+	inline auto jerk_rows_kernel(softening_model model) {
+		if constexpr (std::is_same_v<Real, float>) return jerk_kernel(active_simd, model);
+		else return with_softening(model, [](auto soft) { return &jerk_rows<decltype(soft), Real>; });
+	}
+
+	//  :       ,
+	//            .
+	// phi (  nullptr,   bodies.size()) -       
+	template<typename Real>
+	void direct_accelerations(BasicBodySystem<Real>& bodies, const Softening& softening, Real* phi = nullptr) {
+		constexpr size_t block = 64;
+		const auto kernel = direct_rows_kernel<Real>(softening.model);
+		const size_t n = bodies.size();
+		const float length = softening.length;
+		parallel_for(( n + block - 1 ) / block, [&bodies, kernel, n, length, phi](size_t b) {
+			kernel(bodies.x(), bodies.y(), bodies.mass(), n, b * block, std::min(n, ( b + 1 ) * block), length, bodies.ax(), bodies.ay(), phi);
+		});
+	}
+
+	//        targets (   )
+	template<typename Real>
+	void direct_accelerations(BasicBodySystem<Real>& bodies, const std::vector<uint32_t>& targets, const Softening& softening) {
+		const auto kernel = direct_rows_kernel<Real>(softening.model);
+		const size_t n = bodies.size();
+		const float length = softening.length;
+		parallel_for(targets.size(), [&bodies, &targets, kernel, n, length](size_t t) {
+			kernel(bodies.x(), bodies.y(), bodies.mass(), n, targets[t], targets[t] + 1, length, bodies.ax(), bodies.ay(), nullptr);
+		});
+	}
+
+	//    (   )    targets   n      ;
+	//      x, y, vx, vy (,    ),  k- 
+	//    ax[k], ay[k], jx[k], jy[k].      ,   direct_accelerations
+	template<typename Real>
+	void direct_jerks(const Real* x, const Real* y, const Real* vx, const Real* vy, const Real* mass, size_t n,
+		const std::vector<uint32_t>& targets, const Softening& softening, Real* ax, Real* ay, Real* jx, Real* jy) {
+		const auto kernel = jerk_rows_kernel<Real>(softening.model);
+		const float length = softening.length;
+		parallel_for(targets.size(), [&, kernel, n, length](size_t k) {
+			kernel(x, y, vx, vy, mass, n, targets.data() + k, 1, length, ax + k, ay + k, jx + k, jy + k);
+		});
+	}
+
+	//          :    
+	struct ForceError
+	{
+		size_t samples = 0;
+		float median = 0.0f, p90 = 0.0f, p99 = 0.0f, max = 0.0f;
+	};
+
+	//     bodies.ax, ay    double  samples    (  n)
+	template<typename Real>
+	ForceError force_error(const BasicBodySystem<Real>& bodies, const Softening& softening, size_t samples, unsigned seed = 1) {
+		ForceError result;
+		const size_t n = bodies.size();
+		samples = std::min(samples, n);
+		if (n < 2 || samples == 0) return result;
+
+		//    - :  samples  -   
+		std::mt19937 rng(seed);
+		std::vector<uint32_t> picked(n);
+		for (uint32_t i = 0; i < n; i++) picked[i] = i;
+		for (size_t k = 0; k < samples; k++) std::swap(picked[k], picked[k + rng() % ( n - k )]);
+		picked.resize(samples);
+		std::vector<float> errors(samples);
+		with_softening(softening.model, [&](auto soft) {
+			parallel_for(samples, [&](size_t s) {
+				const uint32_t i = picked[s];
+				const Real* x = bodies.x(), * y = bodies.y(), * m = bodies.mass();
+				double ax = 0.0, ay = 0.0;
+				for (size_t j = 0; j < n; j++) {
+					double dx = double(x[j]) - double(x[i]), dy = double(y[j]) - double(y[i]);
+					double f = G * double(m[j]) * soft.inv_cube(dx * dx + dy * dy, double(softening.length));
+					ax += dx * f;
+					ay += dy * f;
+				}
+				double norm = std::hypot(ax, ay);
+				double diff = std::hypot(double(bodies.ax()[i]) - ax, double(bodies.ay()[i]) - ay);
+				errors[s] = norm > 0.0 ? float(diff / norm) : 0.0f;
+			});
+		});
+		std::sort(errors.begin(), errors.end());
+		auto at = [&](size_t percent) { return errors[std::min(samples - 1, samples * percent / 100)]; };
+		result.samples = samples;
+		result.median = errors[samples / 2];
+		result.p90 = at(90);
+		result.p99 = at(99);
+		result.max = errors.back();
+		return result;
+	}
+}
\ No newline at end of file
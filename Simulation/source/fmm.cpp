@@ -0,0 +1,440 @@
+#include "fmm.h"
+#include "body.h"
+#include "parallel.h"
+#include "gravity_kernels.h"
+#include <algorithm>
+#include <cmath>
+
+namespace grav
+{
+	namespace
+	{
+		constexpr int max_order = 16;
+		constexpr int max_terms = ( max_order + 1 ) * ( max_order + 2 ) / 2;
+		constexpr int max_depth = 32;
+
+		//   n = a + b  : (n, 0), (n - 1, 1), ..., (0, n)
+		constexpr int terms(int p) { return ( p + 1 ) * ( p + 2 ) / 2; }
+		constexpr int index(int a, int b) { return ( a + b ) * ( a + b + 1 ) / 2 + b; }
+
+		struct tables
+		{
+			double inv_fact[max_order + 1];
+			// c(a, i) = a! / (2^i i! (a - 2i)!) -     r^2 / 2
+			double hermite[max_order + 1][max_order / 2 + 1];
+			// (2m - 1)!!   (-1)^m:  1/r  r^2 / 2    / r^(2m + 1)
+			double g[max_order + 1];
+
+			tables() {
+				double f = 1.0;
+				for (int k = 0; k <= max_order; k++) {
+					if (k > 0) f *= k;
+					inv_fact[k] = 1.0 / f;
+				}
+				for (int a = 0; a <= max_order; a++)
+					for (int i = 0; 2 * i <= a; i++)
+						hermite[a][i] = 1.0 / ( inv_fact[a] * std::pow(2.0, i) ) * inv_fact[i] * inv_fact[a - 2 * i];
+				double dfact = 1.0;
+				for (int m = 0; m <= max_order; m++) {
+					if (m > 0) dfact *= 2 * m - 1;
+					g[m] = m % 2 ? -dfact : dfact;
+				}
+			}
+		};
+		const tables table;
+
+		// out[k] = x^k / k!
+		void scaled_powers(double x, int p, double* out) {
+			out[0] = 1.0;
+			for (int k = 1; k <= p; k++) out[k] = out[k - 1] * x / k;
+		}
+
+		// sum m phi(r)  (px, py)   [0, count),   
+		template<typename Soft>
+		double pair_potential(const float* x, const float* y, const float* mass, size_t count, float px, float py, float length) {
+			double phi = 0.0;
+			for (size_t j = 0; j < count; j++) {
+				float dx = x[j] - px, dy = y[j] - py, r2 = dx * dx + dy * dy;
+				if (r2 > 0.0f) phi += mass[j] * Soft::potential(r2, length);
+			}
+			return phi;
+		}
+
+		// D[a, b] = d^a/dx^a d^b/dy^b (1 / |R|)  a + b <= p
+		void derivatives(double x, double y, int p, double* d) {
+			double r2 = x * x + y * y;
+			double inv_r2 = 1.0 / r2;
+			double gm[max_order + 1];
+			double gr = 1.0 / std::sqrt(r2);
+			for (int m = 0; m <= p; m++) {
+				gm[m] = table.g[m] * gr;
+				gr *= inv_r2;
+			}
+			double px[max_order + 1], py[max_order + 1];
+			px[0] = py[0] = 1.0;
+			for (int k = 1; k <= p; k++) {
+				px[k] = px[k - 1] * x;
+				py[k] = py[k - 1] * y;
+			}
+			for (int n = 0; n <= p; n++)
+				for (int b = 0; b <= n; b++) {
+					int a = n - b;
+					double sum = 0.0;
+					for (int i = 0; 2 * i <= a; i++)
+						for (int j = 0; 2 * j <= b; j++)
+							sum += table.hermite[a][i] * table.hermite[b][j] * px[a - 2 * i] * py[b - 2 * j] * gm[n - i - j];
+					d[index(a, b)] = sum;
+				}
+		}
+	}
+
+	void FmmSolver::build(const BodySystem& bodies) {
+		const size_t n = bodies.size();
+		m_x.assign(bodies.x(), bodies.x() + n);
+		m_y.assign(bodies.y(), bodies.y() + n);
+		m_m.assign(bodies.mass(), bodies.mass() + n);
+		m_order.resize(n);
+		for (uint32_t i = 0; i < n; i++) m_order[i] = i;
+		m_nodes.clear();
+
+		float lo_x = m_x[0], hi_x = lo_x, lo_y = m_y[0], hi_y = lo_y;
+		for (size_t i = 0; i < n; i++) {
+			lo_x = std::min(lo_x, m_x[i]);
+			hi_x = std::max(hi_x, m_x[i]);
+			lo_y = std::min(lo_y, m_y[i]);
+			hi_y = std::max(hi_y, m_y[i]);
+		}
+		node root;
+		root.cx = ( lo_x + hi_x ) * 0.5f;
+		root.cy = ( lo_y + hi_y ) * 0.5f;
+		root.half = std::max(hi_x - lo_x, hi_y - lo_y) * 0.5f + 1e-3f;
+		root.begin = 0;
+		root.end = uint32_t(n);
+		m_nodes.push_back(root);
+		split(0, 0);
+
+		//     -     
+		std::vector<float> x(n), y(n), m(n);
+		for (size_t i = 0; i < n; i++) {
+			x[i] = m_x[m_order[i]];
+			y[i] = m_y[m_order[i]];
+			m[i] = m_m[m_order[i]];
+		}
+		m_x.swap(x);
+		m_y.swap(y);
+		m_m.swap(m);
+	}
+
+	void FmmSolver::split(int ni, int depth) {
+		const node cell = m_nodes[ni];
+		if (int(cell.end - cell.begin) <= leaf_size || depth >= max_depth) return;
+
+		//    :   y,     x
+		auto first = m_order.begin() + cell.begin, last = m_order.begin() + cell.end;
+		auto mid_y = std::partition(first, last, [&](uint32_t i) { return m_y[i] < cell.cy; });
+		auto low = std::partition(first, mid_y, [&](uint32_t i) { return m_x[i] < cell.cx; });
+		auto high = std::partition(mid_y, last, [&](uint32_t i) { return m_x[i] < cell.cx; });
+		decltype(first) bounds[5] = { first, low, mid_y, high, last };
+
+		int child = int(m_nodes.size());
+		float h = cell.half * 0.5f;
+		for (int q = 0; q < 4; q++) {
+			if (bounds[q] == bounds[q + 1]) continue;
+			node c;
+			c.cx = cell.cx + ( q & 1 ? h : -h );
+			c.cy = cell.cy + ( q & 2 ? h : -h );
+			c.half = h;
+			c.begin = uint32_t(bounds[q] - m_order.begin());
+			c.end = uint32_t(bounds[q + 1] - m_order.begin());
+			m_nodes.push_back(c);
+		}
+		m_nodes[ni].child = child;
+		m_nodes[ni].children = int(m_nodes.size()) - child;
+		for (int c = child; c < child + m_nodes[ni].children; c++) split(c, depth + 1);
+	}
+
+	// ,  ,    ;     
+	void FmmSolver::upward(int ni) {
+		const int p = m_order_used, t = terms(p);
+		node& cell = m_nodes[ni];
+		double* mp = &m_multipole[size_t(ni) * t];
+		std::fill(mp, mp + t, 0.0);
+		double px[max_order + 1], py[max_order + 1];
+
+		if (cell.child < 0) {
+			double mass = 0.0, mx = 0.0, my = 0.0;
+			for (uint32_t i = cell.begin; i < cell.end; i++) {
+				mass += m_m[i];
+				mx += double(m_m[i]) * m_x[i];
+				my += double(m_m[i]) * m_y[i];
+			}
+			cell.mass = mass;
+			cell.zx = mass > 0.0 ? mx / mass : cell.cx;
+			cell.zy = mass > 0.0 ? my / mass : cell.cy;
+			double r2 = 0.0;
+			for (uint32_t i = cell.begin; i < cell.end; i++) {
+				double vx = m_x[i] - cell.zx, vy = m_y[i] - cell.zy;
+				r2 = std::max(r2, vx * vx + vy * vy);
+				// M[a, b] = sum m (-v)^(a, b) / (a! b!)
+				scaled_powers(-vx, p, px);
+				scaled_powers(-vy, p, py);
+				for (int n = 0; n <= p; n++)
+					for (int b = 0; b <= n; b++) mp[index(n - b, b)] += m_m[i] * px[n - b] * py[b];
+			}
+			cell.radius = std::sqrt(r2);
+			return;
+		}
+
+		double mass = 0.0, mx = 0.0, my = 0.0;
+		for (int c = cell.child; c < cell.child + cell.children; c++) {
+			mass += m_nodes[c].mass;
+			mx += m_nodes[c].mass * m_nodes[c].zx;
+			my += m_nodes[c].mass * m_nodes[c].zy;
+		}
+		cell.mass = mass;
+		cell.zx = mass > 0.0 ? mx / mass : cell.cx;
+		cell.zy = mass > 0.0 ? my / mass : cell.cy;
+
+		//  -   :       
+		double radius = 0.0;
+		for (int c = cell.child; c < cell.child + cell.children; c++) {
+			const node& ch = m_nodes[c];
+			radius = std::max(radius, std::hypot(ch.zx - cell.zx, ch.zy - cell.zy) + ch.radius);
+		}
+		double corner = std::hypot(std::abs(cell.zx - cell.cx) + cell.half, std::abs(cell.zy - cell.cy) + cell.half);
+		cell.radius = std::min(radius, corner);
+
+		//      
+		for (int c = cell.child; c < cell.child + cell.children; c++) {
+			const node& ch = m_nodes[c];
+			const double* cm = &m_multipole[size_t(c) * t];
+			scaled_powers(cell.zx - ch.zx, p, px);
+			scaled_powers(cell.zy - ch.zy, p, py);
+			for (int n = 0; n <= p; n++)
+				for (int b = 0; b <= n; b++) {
+					int a = n - b;
+					double sum = 0.0;
+					for (int la = 0; la <= a; la++)
+						for (int lb = 0; lb <= b; lb++) sum += cm[index(la, lb)] * px[a - la] * py[b - lb];
+					mp[index(a, b)] += sum;
+				}
+		}
+	}
+
+	//   i  [begin, end);    r = 0   
+	void FmmSolver::pairwise(uint32_t i, uint32_t begin, uint32_t end, float& ax, float& ay, double& phi) const {
+		m_pull(m_x.data() + begin, m_y.data() + begin, m_m.data() + begin, end - begin, m_x[i], m_y[i], softening.length, ax, ay);
+		if (potential) phi += m_pair_potential(m_x.data() + begin, m_y.data() + begin, m_m.data() + begin, end - begin, m_x[i], m_y[i], softening.length);
+	}
+
+	//     b     a;    a   
+	void FmmSolver::walk(int a, int b, size_t& interactions) {
+		const node& A = m_nodes[a];
+		const node& B = m_nodes[b];
+		const bool leaf_a = A.child < 0, leaf_b = B.child < 0;
+		const size_t targets = wanted(A.begin, A.end);
+		if (targets == 0) return;
+
+		if (a == b) {
+			if (leaf_a) {
+				for (uint32_t i = A.begin; i < A.end; i++) {
+					if (!wanted(i, i + 1)) continue;
+					float ax = 0.0f, ay = 0.0f;
+					double phi = 0.0;
+					pairwise(i, A.begin, A.end, ax, ay, phi);
+					m_ax[i] += ax;
+					m_ay[i] += ay;
+					if (potential) m_phi[i] += G * phi;
+				}
+				interactions += targets * ( A.end - A.begin - 1 );
+				return;
+			}
+			for (int ca = A.child; ca < A.child + A.children; ca++)
+				for (int cb = A.child; cb < A.child + A.children; cb++) walk(ca, cb, interactions);
+			return;
+		}
+
+		const double rx = A.zx - B.zx, ry = A.zy - B.zy;
+		const double reach = A.radius + B.radius;
+		const double opening = std::min(double(theta), 0.99);
+		if (reach * reach < opening * opening * ( rx * rx + ry * ry )) {
+			//  B    A
+			const int p = m_order_used, t = terms(p);
+			double d[max_terms];
+			derivatives(rx, ry, p, d);
+			const double* mp = &m_multipole[size_t(b) * t];
+			double* lp = &m_local[size_t(a) * t];
+			for (int n = 0; n <= p; n++)
+				for (int nb = 0; nb <= n; nb++) {
+					int na = n - nb;
+					double sum = 0.0;
+					for (int k = 0; k <= p - n; k++)
+						for (int kb = 0; kb <= k; kb++) sum += mp[index(k - kb, kb)] * d[index(na + k - kb, nb + kb)];
+					lp[index(na, nb)] += sum;
+				}
+			interactions++;
+			return;
+		}
+
+		if (leaf_a && leaf_b) {
+			for (uint32_t i = A.begin; i < A.end; i++) {
+				if (!wanted(i, i + 1)) continue;
+				float ax = 0.0f, ay = 0.0f;
+				double phi = 0.0;
+				pairwise(i, B.begin, B.end, ax, ay, phi);
+				m_ax[i] += ax;
+				m_ay[i] += ay;
+				if (potential) m_phi[i] += G * phi;
+			}
+			interactions += targets * ( B.end - B.begin );
+			return;
+		}
+
+		//    (  )
+		if (leaf_a || ( !leaf_b && B.radius >= A.radius ))
+			for (int cb = B.child; cb < B.child + B.children; cb++) walk(a, cb, interactions);
+		else
+			for (int ca = A.child; ca < A.child + A.children; ca++) walk(ca, b, interactions);
+	}
+
+	//           
+	void FmmSolver::downward(int ni) {
+		const int p = m_order_used, t = terms(p);
+		const node& cell = m_nodes[ni];
+		if (wanted(cell.begin, cell.end) == 0) return;
+		const double* lp = &m_local[size_t(ni) * t];
+		double px[max_order + 1], py[max_order + 1];
+
+		if (cell.child < 0) {
+			// a = G grad(sum L_n u^n / n!)
+			for (uint32_t i = cell.begin; i < cell.end; i++) {
+				if (!wanted(i, i + 1)) continue;
+				scaled_powers(m_x[i] - cell.zx, p, px);
+				scaled_powers(m_y[i] - cell.zy, p, py);
+				double ax = 0.0, ay = 0.0;
+				for (int n = 0; n < p; n++)
+					for (int b = 0; b <= n; b++) {
+						int a = n - b;
+						double u = px[a] * py[b];
+						ax += lp[index(a + 1, b)] * u;
+						ay += lp[index(a, b + 1)] * u;
+					}
+				m_ax[i] += float(G * ax);
+				m_ay[i] += float(G * ay);
+				if (!potential) continue;
+				// phi = -G sum L_n u^n / n!,    p
+				double phi = 0.0;
+				for (int n = 0; n <= p; n++)
+					for (int b = 0; b <= n; b++) phi += lp[index(n - b, b)] * px[n - b] * py[b];
+				m_phi[i] -= G * phi;
+			}
+			return;
+		}
+
+		for (int c = cell.child; c < cell.child + cell.children; c++) {
+			if (wanted(m_nodes[c].begin, m_nodes[c].end) == 0) continue;
+			double* cl = &m_local[size_t(c) * t];
+			scaled_powers(m_nodes[c].zx - cell.zx, p, px);
+			scaled_powers(m_nodes[c].zy - cell.zy, p, py);
+			for (int n = 0; n <= p; n++)
+				for (int b = 0; b <= n; b++) {
+					int a = n - b;
+					double sum = 0.0;
+					for (int k = n; k <= p; k++)
+						for (int kb = b; kb <= k - a; kb++) sum += lp[index(k - kb, kb)] * px[k - kb - a] * py[kb - b];
+					cl[index(a, b)] += sum;
+				}
+			downward(c);
+		}
+	}
+
+	void FmmSolver::run(BodySystem& bodies, const std::vector<uint32_t>* targets) {
+		const size_t n = bodies.size();
+		m_interactions = 0;
+		m_result_x.assign(n, 0.0f);
+		m_result_y.assign(n, 0.0f);
+		m_result_phi.assign(potential ? n : 0, 0.0f);
+		if (n == 0) return;
+
+		m_order_used = std::clamp(order, 1, max_order);
+		m_pull = pull_kernel(active_simd, softening.model);
+		m_pair_potential = with_softening(softening.model, [](auto soft) { return &pair_potential<decltype(soft)>; });
+		leaf_size = std::max(leaf_size, 1);
+		build(bodies);
+		m_before.clear();
+		if (targets) {
+			std::vector<uint8_t> flag(n, 0);
+			for (uint32_t i : *targets) flag[i] = 1;
+			m_before.assign(n + 1, 0);
+			for (size_t i = 0; i < n; i++) m_before[i + 1] = m_before[i] + flag[m_order[i]];
+		}
+		const int t = terms(m_order_used);
+		m_multipole.assign(m_nodes.size() * t, 0.0);
+		m_local.assign(m_nodes.size() * t, 0.0);
+		m_ax.assign(n, 0.0f);
+		m_ay.assign(n, 0.0f);
+		m_phi.assign(potential ? n : 0, 0.0);
+
+		//   :   ,       
+		m_frontier.assign(1, 0);
+		m_above.assign(m_nodes.size(), 0);
+		while (m_frontier.size() < 16 * size_t(thread_count)) {
+			std::vector<int> next;
+			bool split = false;
+			for (int ni : m_frontier) {
+				if (m_nodes[ni].child < 0) {
+					next.push_back(ni);
+					continue;
+				}
+				m_above[ni] = 1;
+				split = true;
+				for (int c = m_nodes[ni].child; c < m_nodes[ni].child + m_nodes[ni].children; c++) next.push_back(c);
+			}
+			if (!split) break;
+			m_frontier.swap(next);
+		}
+
+		// :  ,    -    
+		parallel_for(m_frontier.size(), [this](size_t f) {
+			auto up = [this](auto& self, int ni) -> void {
+				const node& cell = m_nodes[ni];
+				for (int c = cell.child; c < cell.child + cell.children; c++) self(self, c);
+				upward(ni);
+			};
+			up(up, m_frontier[f]);
+		});
+		for (int ni = int(m_nodes.size()) - 1; ni >= 0; ni--) if (m_above[ni]) upward(ni);
+
+		//    ,     ,     
+		std::vector<size_t> counts(m_frontier.size(), 0);
+		parallel_for(m_frontier.size(), [this, &counts](size_t f) {
+			walk(m_frontier[f], 0, counts[f]);
+			downward(m_frontier[f]);
+		});
+		for (size_t c : counts) m_interactions += c;
+
+		for (size_t i = 0; i < n; i++) {
+			m_result_x[m_order[i]] = m_ax[i];
+			m_result_y[m_order[i]] = m_ay[i];
+		}
+		if (potential) for (size_t i = 0; i < n; i++) m_result_phi[m_order[i]] = float(m_phi[i]);
+	}
+
+	void FmmSolver::compute(BodySystem& bodies) {
+		run(bodies);
+		std::copy(m_result_x.begin(), m_result_x.end(), bodies.ax());
+		std::copy(m_result_y.begin(), m_result_y.end(), bodies.ay());
+	}
+
+	void FmmSolver::compute(BodySystem& bodies, const std::vector<uint32_t>& targets) {
+		run(bodies, &targets);
+		for (uint32_t i : targets) {
+			bodies.ax()[i] = m_result_x[i];
+			bodies.ay()[i] = m_result_y[i];
+		}
+	}
+
+	ForceError FmmSolver::verify(const BodySystem& bodies, size_t samples, unsigned seed) const {
+		return force_error(bodies, softening, samples, seed);
+	}
+}
\ No newline at end of file
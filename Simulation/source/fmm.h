@@ -0,0 +1,81 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "body_system.h"
+#include "direct.h"
+#include "gravity_kernels.h"
+#include "softening.h"
+
+namespace grav
+{
+	//   :       order
+	//     ,  -    .
+	//  1/r^2 ( 1/r)    ,   
+	//  FMM   ,      
+	class FmmSolver {
+	public:
+		//  :    ,  - -   order^4
+		int order = 4;
+		//  A  B   ,  r_A + r_B < theta * |z_A - z_B|
+		float theta = 0.5f;
+		//      
+		int leaf_size = 16;
+		//    -;     ,
+		// ,    ,   
+		Softening softening;
+		//     :   - ,  -   
+		bool potential = false;
+
+		//   
+		void compute(BodySystem& bodies);
+		//     targets:     ,
+		//       -   ,    
+		void compute(BodySystem& bodies, const std::vector<uint32_t>& targets);
+
+		//   -  -    
+		size_t interactions() const noexcept { return m_interactions; }
+		//  G sum m phi(r)   (  )     potential
+		const std::vector<float>& potentials() const noexcept { return m_result_phi; }
+
+		//  ,   bodies  compute(bodies),       
+		ForceError verify(const BodySystem& bodies, size_t samples, unsigned seed = 1) const;
+
+	private:
+		struct node
+		{
+			float cx, cy, half;			//  
+			double zx = 0.0, zy = 0.0;	//   -  
+			double mass = 0.0, radius = 0.0;
+			uint32_t begin, end;		//    m_order
+			int child = -1, children = 0;
+		};
+
+		std::vector<node> m_nodes;
+		std::vector<uint32_t> m_order;		//      
+		std::vector<float> m_x, m_y, m_m;	//    
+		std::vector<float> m_ax, m_ay;		//    
+		std::vector<double> m_multipole, m_local;
+		std::vector<int> m_frontier;		//  ,   
+		std::vector<uint8_t> m_above;		//     
+		std::vector<double> m_phi;			//    
+		std::vector<uint32_t> m_before;		//        ;  -  
+		std::vector<float> m_result_x, m_result_y, m_result_phi;	//    
+		size_t m_interactions = 0;
+		int m_order_used = 0;
+		PullKernel m_pull = nullptr;
+		// sum m phi(r)    ,  SIMD:      
+		using PotentialSum = double(*)(const float* x, const float* y, const float* mass, size_t count, float px, float py, float length);
+		PotentialSum m_pair_potential = nullptr;
+
+		//      [begin, end) 
+		size_t wanted(uint32_t begin, uint32_t end) const noexcept { return m_before.empty() ? end - begin : m_before[end] - m_before[begin]; }
+
+		void build(const BodySystem& bodies);
+		void split(int ni, int depth);
+		void upward(int ni);
+		void pairwise(uint32_t i, uint32_t begin, uint32_t end, float& ax, float& ay, double& phi) const;
+		void walk(int a, int b, size_t& interactions);
+		void downward(int ni);
+		void run(BodySystem& bodies, const std::vector<uint32_t>* targets = nullptr);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,616 @@
+#include "gravity_kernels.h"
+#include "body.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define GRAV_TARGET(features)
+#else
+#include <cpuid.h>
+#define GRAV_TARGET(features) __attribute__((target(features)))
+#endif
+
+namespace grav
+{
+	namespace
+	{
+		void cpuid(int leaf, int sub, uint32_t regs[4]) {
+#if defined(_MSC_VER)
+			int r[4];
+			__cpuidex(r, leaf, sub);
+			for (int i = 0; i < 4; i++) regs[i] = uint32_t(r[i]);
+#else
+			__cpuid_count(leaf, sub, regs[0], regs[1], regs[2], regs[3]);
+#endif
+		}
+
+		GRAV_TARGET("xsave")
+		uint64_t xgetbv0() {
+			return _xgetbv(0);
+		}
+
+		//       :     ,    
+		constexpr int group_block = 4;
+
+		GRAV_TARGET("avx2,fma")
+		float hsum(__m256 v) {
+			__m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+			s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+			s = _mm_add_ss(s, _mm_movehdup_ps(s));
+			return _mm_cvtss_f32(s);
+		}
+
+		// 1/sqrt(x)    : inv * (1.5 - 0.5 * x * inv^2)
+		GRAV_TARGET("avx2,fma")
+		__m256 rsqrt(__m256 x) {
+			__m256 inv = _mm256_rsqrt_ps(x);
+			return _mm256_mul_ps(inv, _mm256_fnmadd_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), x), _mm256_mul_ps(inv, inv), _mm256_set1_ps(1.5f)));
+		}
+
+		GRAV_TARGET("avx2,fma")
+		__m256 cube(__m256 v) {
+			return _mm256_mul_ps(v, _mm256_mul_ps(v, v));
+		}
+
+		//   soften::*::inv_cube;  r2 = 0  ,     
+		GRAV_TARGET("avx2,fma")
+		__m256 inv_cube(soften::none, __m256 r2, float) {
+			return cube(rsqrt(r2));
+		}
+
+		GRAV_TARGET("avx2,fma")
+		__m256 inv_cube(soften::plummer, __m256 r2, float length) {
+			return cube(rsqrt(_mm256_add_ps(r2, _mm256_set1_ps(length * length))));
+		}
+
+		GRAV_TARGET("avx2,fma")
+		__m256 inv_cube(soften::truncated, __m256 r2, float length) {
+			return cube(rsqrt(_mm256_max_ps(r2, _mm256_set1_ps(length * length))));
+		}
+
+		GRAV_TARGET("avx2,fma")
+		__m256 inv_cube(soften::spline, __m256 r2, float length) {
+			const float inv_h = 1.0f / length;
+			const __m256 inv_h3 = _mm256_set1_ps(inv_h * inv_h * inv_h);
+			__m256 inv = rsqrt(r2);
+			__m256 u = _mm256_mul_ps(_mm256_mul_ps(r2, inv), _mm256_set1_ps(inv_h)), u2 = _mm256_mul_ps(u, u);
+			__m256 far = cube(inv);
+			__m256 near = _mm256_fmadd_ps(u2, _mm256_fmsub_ps(_mm256_set1_ps(32.0f), u, _mm256_set1_ps(38.4f)), _mm256_set1_ps(32.0f / 3));
+			__m256 mid = _mm256_fnmadd_ps(_mm256_set1_ps(32.0f / 3), u, _mm256_set1_ps(38.4f));
+			mid = _mm256_fmadd_ps(u, _mm256_fmadd_ps(u, mid, _mm256_set1_ps(-48.0f)), _mm256_set1_ps(64.0f / 3));
+			mid = _mm256_fnmadd_ps(far, _mm256_set1_ps(1.0f / 15), _mm256_mul_ps(inv_h3, mid));
+			__m256 f = _mm256_blendv_ps(far, mid, _mm256_cmp_ps(u, _mm256_set1_ps(1.0f), _CMP_LT_OQ));
+			return _mm256_blendv_ps(f, _mm256_mul_ps(inv_h3, near), _mm256_cmp_ps(u, _mm256_set1_ps(0.5f), _CMP_LT_OQ));
+		}
+
+		//   soften::*::potential,      r2 = 0
+		GRAV_TARGET("avx2,fma")
+		__m256 potential(soften::none, __m256 r2, float) {
+			return _mm256_sub_ps(_mm256_setzero_ps(), rsqrt(r2));
+		}
+
+		GRAV_TARGET("avx2,fma")
+		__m256 potential(soften::plummer, __m256 r2, float length) {
+			return _mm256_sub_ps(_mm256_setzero_ps(), rsqrt(_mm256_add_ps(r2, _mm256_set1_ps(length * length))));
+		}
+
+		GRAV_TARGET("avx2,fma")
+		__m256 potential(soften::truncated, __m256 r2, float length) {
+			const float inv_h = 1.0f / length;
+			__m256 inside = _mm256_fmsub_ps(r2, _mm256_set1_ps(0.5f * inv_h * inv_h * inv_h), _mm256_set1_ps(1.5f * inv_h));
+			__m256 outside = _mm256_sub_ps(_mm256_setzero_ps(), rsqrt(r2));
+			return _mm256_blendv_ps(outside, inside, _mm256_cmp_ps(r2, _mm256_set1_ps(length * length), _CMP_LT_OQ));
+		}
+
+		GRAV_TARGET("avx2,fma")
+		__m256 potential(soften::spline, __m256 r2, float length) {
+			const float inv_h = 1.0f / length;
+			const __m256 h = _mm256_set1_ps(inv_h);
+			__m256 inv = rsqrt(r2);
+			__m256 u = _mm256_mul_ps(_mm256_mul_ps(r2, inv), h), u2 = _mm256_mul_ps(u, u);
+			__m256 near = _mm256_fmsub_ps(_mm256_set1_ps(6.4f), u, _mm256_set1_ps(9.6f));
+			near = _mm256_fmadd_ps(u2, _mm256_fmadd_ps(u2, near, _mm256_set1_ps(16.0f / 3)), _mm256_set1_ps(-2.8f));
+			__m256 mid = _mm256_fnmadd_ps(_mm256_set1_ps(32.0f / 15), u, _mm256_set1_ps(9.6f));
+			mid = _mm256_fmadd_ps(u, _mm256_fmadd_ps(u, mid, _mm256_set1_ps(-16.0f)), _mm256_set1_ps(32.0f / 3));
+			mid = _mm256_fmadd_ps(u2, mid, _mm256_set1_ps(-3.2f));
+			mid = _mm256_fmadd_ps(inv, _mm256_set1_ps(1.0f / 15), _mm256_mul_ps(h, mid));
+			__m256 f = _mm256_blendv_ps(_mm256_sub_ps(_mm256_setzero_ps(), inv), mid, _mm256_cmp_ps(u, _mm256_set1_ps(1.0f), _CMP_LT_OQ));
+			return _mm256_blendv_ps(f, _mm256_mul_ps(h, near), _mm256_cmp_ps(u, _mm256_set1_ps(0.5f), _CMP_LT_OQ));
+		}
+
+		//   soften::*::slope  ,  r2 = 0   
+		GRAV_TARGET("avx2,fma")
+		__m256 slope(soften::none, __m256 r2, float) {
+			__m256 inv = rsqrt(r2);
+			return _mm256_mul_ps(_mm256_set1_ps(-3.0f), _mm256_mul_ps(cube(inv), _mm256_mul_ps(inv, inv)));
+		}
+
+		GRAV_TARGET("avx2,fma")
+		__m256 slope(soften::plummer, __m256 r2, float length) {
+			__m256 inv = rsqrt(_mm256_add_ps(r2, _mm256_set1_ps(length * length)));
+			return _mm256_mul_ps(_mm256_set1_ps(-3.0f), _mm256_mul_ps(cube(inv), _mm256_mul_ps(inv, inv)));
+		}
+
+		GRAV_TARGET("avx2,fma")
+		__m256 slope(soften::truncated, __m256 r2, float length) {
+			__m256 inv = rsqrt(r2);
+			__m256 far = _mm256_mul_ps(_mm256_set1_ps(-3.0f), _mm256_mul_ps(cube(inv), _mm256_mul_ps(inv, inv)));
+			return _mm256_and_ps(far, _mm256_cmp_ps(r2, _mm256_set1_ps(length * length), _CMP_GT_OQ));
+		}
+
+		GRAV_TARGET("avx2,fma")
+		__m256 slope(soften::spline, __m256 r2, float length) {
+			const float inv_h = 1.0f / length, inv_h2 = inv_h * inv_h;
+			const __m256 inv_h5 = _mm256_set1_ps(inv_h2 * inv_h2 * inv_h);
+			__m256 inv = rsqrt(r2);
+			// 1 / u = length / r
+			__m256 u = _mm256_mul_ps(_mm256_mul_ps(r2, inv), _mm256_set1_ps(inv_h)), iu = _mm256_mul_ps(inv, _mm256_set1_ps(length)), iu2 = _mm256_mul_ps(iu, iu);
+			__m256 far = _mm256_mul_ps(_mm256_set1_ps(-3.0f), _mm256_mul_ps(cube(inv), _mm256_mul_ps(inv, inv)));
+			__m256 near = _mm256_fmsub_ps(_mm256_set1_ps(96.0f), u, _mm256_set1_ps(76.8f));
+			__m256 mid = _mm256_fmadd_ps(_mm256_mul_ps(_mm256_set1_ps(0.2f), _mm256_mul_ps(iu2, iu2)), iu, _mm256_set1_ps(76.8f));
+			mid = _mm256_fnmadd_ps(_mm256_set1_ps(32.0f), u, _mm256_fnmadd_ps(_mm256_set1_ps(48.0f), iu, mid));
+			__m256 f = _mm256_blendv_ps(far, _mm256_mul_ps(inv_h5, mid), _mm256_cmp_ps(u, _mm256_set1_ps(1.0f), _CMP_LT_OQ));
+			return _mm256_blendv_ps(f, _mm256_mul_ps(inv_h5, near), _mm256_cmp_ps(u, _mm256_set1_ps(0.5f), _CMP_LT_OQ));
+		}
+
+		//  Potential     ;     ,   
+		template<typename Soft, bool Potential>
+		GRAV_TARGET("avx2,fma")
+		void direct_rows_avx2(const float* x, const float* y, const float* mass, size_t n, size_t begin, size_t end, float length, float* ax, float* ay, float* phi) {
+			const size_t padded = ( n + 7 ) & ~size_t(7);
+			const __m256 g = _mm256_set1_ps(G), zero = _mm256_setzero_ps();
+			for (size_t i = begin; i < end; i++) {
+				const __m256 xi = _mm256_set1_ps(x[i]), yi = _mm256_set1_ps(y[i]);
+				__m256 accx = zero, accy = zero, pot = zero;
+				for (size_t j = 0; j < padded; j += 8) {
+					__m256 dx = _mm256_sub_ps(_mm256_load_ps(x + j), xi);
+					__m256 dy = _mm256_sub_ps(_mm256_load_ps(y + j), yi);
+					__m256 r2 = _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx));
+					//   (    )  
+					__m256 valid = _mm256_cmp_ps(r2, zero, _CMP_GT_OQ);
+					__m256 f = _mm256_and_ps(inv_cube(Soft{}, r2, length), valid);
+					__m256 m = _mm256_load_ps(mass + j);
+					__m256 s = _mm256_mul_ps(_mm256_mul_ps(g, m), f);
+					accx = _mm256_fmadd_ps(dx, s, accx);
+					accy = _mm256_fmadd_ps(dy, s, accy);
+					if constexpr (Potential) pot = _mm256_fmadd_ps(m, _mm256_and_ps(potential(Soft{}, r2, length), valid), pot);
+				}
+				ax[i] = hsum(accx);
+				ay[i] = hsum(accy);
+				if constexpr (Potential) phi[i] = G * hsum(pot);
+			}
+		}
+
+		template<typename Soft>
+		void direct_avx2(const float* x, const float* y, const float* mass, size_t n, size_t begin, size_t end, float length, float* ax, float* ay, float* phi) {
+			if (phi) direct_rows_avx2<Soft, true>(x, y, mass, n, begin, end, length, ax, ay, phi);
+			else direct_rows_avx2<Soft, false>(x, y, mass, n, begin, end, length, ax, ay, phi);
+		}
+
+		GRAV_TARGET("avx512f")
+		float hsum(__m512 v) {
+			alignas(64) float lanes[16];
+			_mm512_store_ps(lanes, v);
+			float s = 0.0f;
+			for (float l : lanes) s += l;
+			return s;
+		}
+
+		GRAV_TARGET("avx512f")
+		__m512 rsqrt(__m512 x) {
+			__m512 inv = _mm512_rsqrt14_ps(x);
+			return _mm512_mul_ps(inv, _mm512_fnmadd_ps(_mm512_mul_ps(_mm512_set1_ps(0.5f), x), _mm512_mul_ps(inv, inv), _mm512_set1_ps(1.5f)));
+		}
+
+		GRAV_TARGET("avx512f")
+		__m512 cube(__m512 v) {
+			return _mm512_mul_ps(v, _mm512_mul_ps(v, v));
+		}
+
+		GRAV_TARGET("avx512f")
+		__m512 inv_cube(soften::none, __m512 r2, float) {
+			return cube(rsqrt(r2));
+		}
+
+		GRAV_TARGET("avx512f")
+		__m512 inv_cube(soften::plummer, __m512 r2, float length) {
+			return cube(rsqrt(_mm512_add_ps(r2, _mm512_set1_ps(length * length))));
+		}
+
+		GRAV_TARGET("avx512f")
+		__m512 inv_cube(soften::truncated, __m512 r2, float length) {
+			return cube(rsqrt(_mm512_max_ps(r2, _mm512_set1_ps(length * length))));
+		}
+
+		GRAV_TARGET("avx512f")
+		__m512 inv_cube(soften::spline, __m512 r2, float length) {
+			const float inv_h = 1.0f / length;
+			const __m512 inv_h3 = _mm512_set1_ps(inv_h * inv_h * inv_h);
+			__m512 inv = rsqrt(r2);
+			__m512 u = _mm512_mul_ps(_mm512_mul_ps(r2, inv), _mm512_set1_ps(inv_h)), u2 = _mm512_mul_ps(u, u);
+			__m512 far = cube(inv);
+			__m512 near = _mm512_fmadd_ps(u2, _mm512_fmsub_ps(_mm512_set1_ps(32.0f), u, _mm512_set1_ps(38.4f)), _mm512_set1_ps(32.0f / 3));
+			__m512 mid = _mm512_fnmadd_ps(_mm512_set1_ps(32.0f / 3), u, _mm512_set1_ps(38.4f));
+			mid = _mm512_fmadd_ps(u, _mm512_fmadd_ps(u, mid, _mm512_set1_ps(-48.0f)), _mm512_set1_ps(64.0f / 3));
+			mid = _mm512_fnmadd_ps(far, _mm512_set1_ps(1.0f / 15), _mm512_mul_ps(inv_h3, mid));
+			__m512 f = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(u, _mm512_set1_ps(1.0f), _CMP_LT_OQ), far, mid);
+			return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(u, _mm512_set1_ps(0.5f), _CMP_LT_OQ), f, _mm512_mul_ps(inv_h3, near));
+		}
+
+		GRAV_TARGET("avx512f")
+		__m512 potential(soften::none, __m512 r2, float) {
+			return _mm512_sub_ps(_mm512_setzero_ps(), rsqrt(r2));
+		}
+
+		GRAV_TARGET("avx512f")
+		__m512 potential(soften::plummer, __m512 r2, float length) {
+			return _mm512_sub_ps(_mm512_setzero_ps(), rsqrt(_mm512_add_ps(r2, _mm512_set1_ps(length * length))));
+		}
+
+		GRAV_TARGET("avx512f")
+		__m512 potential(soften::truncated, __m512 r2, float length) {
+			const float inv_h = 1.0f / length;
+			__m512 inside = _mm512_fmsub_ps(r2, _mm512_set1_ps(0.5f * inv_h * inv_h * inv_h), _mm512_set1_ps(1.5f * inv_h));
+			__m512 outside = _mm512_sub_ps(_mm512_setzero_ps(), rsqrt(r2));
+			return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(r2, _mm512_set1_ps(length * length), _CMP_LT_OQ), outside, inside);
+		}
+
+		GRAV_TARGET("avx512f")
+		__m512 potential(soften::spline, __m512 r2, float length) {
+			const float inv_h = 1.0f / length;
+			const __m512 h = _mm512_set1_ps(inv_h);
+			__m512 inv = rsqrt(r2);
+			__m512 u = _mm512_mul_ps(_mm512_mul_ps(r2, inv), h), u2 = _mm512_mul_ps(u, u);
+			__m512 near = _mm512_fmsub_ps(_mm512_set1_ps(6.4f), u, _mm512_set1_ps(9.6f));
+			near = _mm512_fmadd_ps(u2, _mm512_fmadd_ps(u2, near, _mm512_set1_ps(16.0f / 3)), _mm512_set1_ps(-2.8f));
+			__m512 mid = _mm512_fnmadd_ps(_mm512_set1_ps(32.0f / 15), u, _mm512_set1_ps(9.6f));
+			mid = _mm512_fmadd_ps(u, _mm512_fmadd_ps(u, mid, _mm512_set1_ps(-16.0f)), _mm512_set1_ps(32.0f / 3));
+			mid = _mm512_fmadd_ps(u2, mid, _mm512_set1_ps(-3.2f));
+			mid = _mm512_fmadd_ps(inv, _mm512_set1_ps(1.0f / 15), _mm512_mul_ps(h, mid));
+			__m512 f = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(u, _mm512_set1_ps(1.0f), _CMP_LT_OQ), _mm512_sub_ps(_mm512_setzero_ps(), inv), mid);
+			return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(u, _mm512_set1_ps(0.5f), _CMP_LT_OQ), f, _mm512_mul_ps(h, near));
+		}
+
+		GRAV_TARGET("avx512f")
+		__m512 slope(soften::none, __m512 r2, float) {
+			__m512 inv = rsqrt(r2);
+			return _mm512_mul_ps(_mm512_set1_ps(-3.0f), _mm512_mul_ps(cube(inv), _mm512_mul_ps(inv, inv)));
+		}
+
+		GRAV_TARGET("avx512f")
+		__m512 slope(soften::plummer, __m512 r2, float length) {
+			__m512 inv = rsqrt(_mm512_add_ps(r2, _mm512_set1_ps(length * length)));
+			return _mm512_mul_ps(_mm512_set1_ps(-3.0f), _mm512_mul_ps(cube(inv), _mm512_mul_ps(inv, inv)));
+		}
+
+		GRAV_TARGET("avx512f")
+		__m512 slope(soften::truncated, __m512 r2, float length) {
+			__m512 inv = rsqrt(r2);
+			__m512 far = _mm512_mul_ps(_mm512_set1_ps(-3.0f), _mm512_mul_ps(cube(inv), _mm512_mul_ps(inv, inv)));
+			return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(r2, _mm512_set1_ps(length * length), _CMP_GT_OQ), far);
+		}
+
+		GRAV_TARGET("avx512f")
+		__m512 slope(soften::spline, __m512 r2, float length) {
+			const float inv_h = 1.0f / length, inv_h2 = inv_h * inv_h;
+			const __m512 inv_h5 = _mm512_set1_ps(inv_h2 * inv_h2 * inv_h);
+			__m512 inv = rsqrt(r2);
+			__m512 u = _mm512_mul_ps(_mm512_mul_ps(r2, inv), _mm512_set1_ps(inv_h)), iu = _mm512_mul_ps(inv, _mm512_set1_ps(length)), iu2 = _mm512_mul_ps(iu, iu);
+			__m512 far = _mm512_mul_ps(_mm512_set1_ps(-3.0f), _mm512_mul_ps(cube(inv), _mm512_mul_ps(inv, inv)));
+			__m512 near = _mm512_fmsub_ps(_mm512_set1_ps(96.0f), u, _mm512_set1_ps(76.8f));
+			__m512 mid = _mm512_fmadd_ps(_mm512_mul_ps(_mm512_set1_ps(0.2f), _mm512_mul_ps(iu2, iu2)), iu, _mm512_set1_ps(76.8f));
+			mid = _mm512_fnmadd_ps(_mm512_set1_ps(32.0f), u, _mm512_fnmadd_ps(_mm512_set1_ps(48.0f), iu, mid));
+			__m512 f = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(u, _mm512_set1_ps(1.0f), _CMP_LT_OQ), far, _mm512_mul_ps(inv_h5, mid));
+			return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(u, _mm512_set1_ps(0.5f), _CMP_LT_OQ), f, _mm512_mul_ps(inv_h5, near));
+		}
+
+		template<typename Soft, bool Potential>
+		GRAV_TARGET("avx512f")
+		void direct_rows_avx512(const float* x, const float* y, const float* mass, size_t n, size_t begin, size_t end, float length, float* ax, float* ay, float* phi) {
+			const size_t padded = ( n + 15 ) & ~size_t(15);
+			const __m512 g = _mm512_set1_ps(G), zero = _mm512_setzero_ps();
+			for (size_t i = begin; i < end; i++) {
+				const __m512 xi = _mm512_set1_ps(x[i]), yi = _mm512_set1_ps(y[i]);
+				__m512 accx = zero, accy = zero, pot = zero;
+				for (size_t j = 0; j < padded; j += 16) {
+					__m512 dx = _mm512_sub_ps(_mm512_load_ps(x + j), xi);
+					__m512 dy = _mm512_sub_ps(_mm512_load_ps(y + j), yi);
+					__m512 r2 = _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dx, dx));
+					__mmask16 valid = _mm512_cmp_ps_mask(r2, zero, _CMP_GT_OQ);
+					__m512 f = _mm512_maskz_mov_ps(valid, inv_cube(Soft{}, r2, length));
+					__m512 m = _mm512_load_ps(mass + j);
+					__m512 s = _mm512_mul_ps(_mm512_mul_ps(g, m), f);
+					accx = _mm512_fmadd_ps(dx, s, accx);
+					accy = _mm512_fmadd_ps(dy, s, accy);
+					if constexpr (Potential) pot = _mm512_fmadd_ps(m, _mm512_maskz_mov_ps(valid, potential(Soft{}, r2, length)), pot);
+				}
+				ax[i] = hsum(accx);
+				ay[i] = hsum(accy);
+				if constexpr (Potential) phi[i] = G * hsum(pot);
+			}
+		}
+
+		template<typename Soft>
+		void direct_avx512(const float* x, const float* y, const float* mass, size_t n, size_t begin, size_t end, float length, float* ax, float* ay, float* phi) {
+			if (phi) direct_rows_avx512<Soft, true>(x, y, mass, n, begin, end, length, ax, ay, phi);
+			else direct_rows_avx512<Soft, false>(x, y, mass, n, begin, end, length, ax, ay, phi);
+		}
+
+		template<typename Soft>
+		void pull_scalar(const float* x, const float* y, const float* mass, size_t count, float px, float py, float length, float& ax, float& ay) {
+			float accx = 0.0f, accy = 0.0f;
+			for (size_t j = 0; j < count; j++) {
+				float dx = x[j] - px, dy = y[j] - py;
+				float s = G * mass[j] * Soft::inv_cube(dx * dx + dy * dy, length);
+				accx += dx * s;
+				accy += dy * s;
+			}
+			ax += accx;
+			ay += accy;
+		}
+
+		template<typename Soft>
+		GRAV_TARGET("avx2,fma")
+		void pull_avx2(const float* x, const float* y, const float* mass, size_t count, float px, float py, float length, float& ax, float& ay) {
+			const __m256 g = _mm256_set1_ps(G), zero = _mm256_setzero_ps();
+			const __m256 xi = _mm256_set1_ps(px), yi = _mm256_set1_ps(py);
+			__m256 accx = zero, accy = zero;
+			size_t j = 0;
+			for (; j + 8 <= count; j += 8) {
+				__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + j), xi);
+				__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + j), yi);
+				__m256 r2 = _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx));
+				__m256 f = _mm256_and_ps(inv_cube(Soft{}, r2, length), _mm256_cmp_ps(r2, zero, _CMP_GT_OQ));
+				__m256 s = _mm256_mul_ps(_mm256_mul_ps(g, _mm256_loadu_ps(mass + j)), f);
+				accx = _mm256_fmadd_ps(dx, s, accx);
+				accy = _mm256_fmadd_ps(dy, s, accy);
+			}
+			ax += hsum(accx);
+			ay += hsum(accy);
+			pull_scalar<Soft>(x + j, y + j, mass + j, count - j, px, py, length, ax, ay);
+		}
+
+		template<typename Soft>
+		GRAV_TARGET("avx512f")
+		void pull_avx512(const float* x, const float* y, const float* mass, size_t count, float px, float py, float length, float& ax, float& ay) {
+			const __m512 g = _mm512_set1_ps(G), zero = _mm512_setzero_ps();
+			const __m512 xi = _mm512_set1_ps(px), yi = _mm512_set1_ps(py);
+			__m512 accx = zero, accy = zero;
+			for (size_t j = 0; j < count; j += 16) {
+				//    ,    r2 = 0  
+				__mmask16 tail = count - j >= 16 ? __mmask16(0xFFFF) : __mmask16(( 1u << ( count - j ) ) - 1);
+				__m512 dx = _mm512_sub_ps(_mm512_maskz_loadu_ps(tail, x + j), xi);
+				__m512 dy = _mm512_sub_ps(_mm512_maskz_loadu_ps(tail, y + j), yi);
+				__m512 r2 = _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dx, dx));
+				__mmask16 valid = _mm512_cmp_ps_mask(r2, zero, _CMP_GT_OQ) & tail;
+				__m512 f = _mm512_maskz_mov_ps(valid, inv_cube(Soft{}, r2, length));
+				__m512 s = _mm512_mul_ps(_mm512_mul_ps(g, _mm512_maskz_loadu_ps(tail, mass + j)), f);
+				accx = _mm512_fmadd_ps(dx, s, accx);
+				accy = _mm512_fmadd_ps(dy, s, accy);
+			}
+			ax += hsum(accx);
+			ay += hsum(accy);
+		}
+
+		// block    i     
+		template<typename Soft, int block>
+		GRAV_TARGET("avx2,fma")
+		void group_block_avx2(const float* x, const float* y, const float* mass, size_t padded, const float* px, const float* py, size_t i, float length, float* ax, float* ay) {
+			const __m256 g = _mm256_set1_ps(G), zero = _mm256_setzero_ps();
+			__m256 xi[block], yi[block], accx[block], accy[block];
+			for (int k = 0; k < block; k++) {
+				xi[k] = _mm256_set1_ps(px[i + k]);
+				yi[k] = _mm256_set1_ps(py[i + k]);
+				accx[k] = accy[k] = zero;
+			}
+			for (size_t j = 0; j < padded; j += 8) {
+				const __m256 sx = _mm256_loadu_ps(x + j), sy = _mm256_loadu_ps(y + j), gm = _mm256_mul_ps(g, _mm256_loadu_ps(mass + j));
+				for (int k = 0; k < block; k++) {
+					__m256 dx = _mm256_sub_ps(sx, xi[k]);
+					__m256 dy = _mm256_sub_ps(sy, yi[k]);
+					__m256 r2 = _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx));
+					__m256 s = _mm256_mul_ps(gm, _mm256_and_ps(inv_cube(Soft{}, r2, length), _mm256_cmp_ps(r2, zero, _CMP_GT_OQ)));
+					accx[k] = _mm256_fmadd_ps(dx, s, accx[k]);
+					accy[k] = _mm256_fmadd_ps(dy, s, accy[k]);
+				}
+			}
+			for (int k = 0; k < block; k++) {
+				ax[i + k] = hsum(accx[k]);
+				ay[i + k] = hsum(accy[k]);
+			}
+		}
+
+		template<typename Soft>
+		GRAV_TARGET("avx2,fma")
+		void group_avx2(const float* x, const float* y, const float* mass, size_t count, const float* px, const float* py, size_t targets, float length, float* ax, float* ay) {
+			const size_t padded = ( count + 7 ) & ~size_t(7);
+			size_t i = 0;
+			for (; i + group_block <= targets; i += group_block) group_block_avx2<Soft, group_block>(x, y, mass, padded, px, py, i, length, ax, ay);
+			for (; i < targets; i++) group_block_avx2<Soft, 1>(x, y, mass, padded, px, py, i, length, ax, ay);
+		}
+
+		template<typename Soft, int block>
+		GRAV_TARGET("avx512f")
+		void group_block_avx512(const float* x, const float* y, const float* mass, size_t padded, const float* px, const float* py, size_t i, float length, float* ax, float* ay) {
+			const __m512 g = _mm512_set1_ps(G), zero = _mm512_setzero_ps();
+			__m512 xi[block], yi[block], accx[block], accy[block];
+			for (int k = 0; k < block; k++) {
+				xi[k] = _mm512_set1_ps(px[i + k]);
+				yi[k] = _mm512_set1_ps(py[i + k]);
+				accx[k] = accy[k] = zero;
+			}
+			for (size_t j = 0; j < padded; j += 16) {
+				const __m512 sx = _mm512_loadu_ps(x + j), sy = _mm512_loadu_ps(y + j), gm = _mm512_mul_ps(g, _mm512_loadu_ps(mass + j));
+				for (int k = 0; k < block; k++) {
+					__m512 dx = _mm512_sub_ps(sx, xi[k]);
+					__m512 dy = _mm512_sub_ps(sy, yi[k]);
+					__m512 r2 = _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dx, dx));
+					__m512 s = _mm512_mul_ps(gm, _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(r2, zero, _CMP_GT_OQ), inv_cube(Soft{}, r2, length)));
+					accx[k] = _mm512_fmadd_ps(dx, s, accx[k]);
+					accy[k] = _mm512_fmadd_ps(dy, s, accy[k]);
+				}
+			}
+			for (int k = 0; k < block; k++) {
+				ax[i + k] = hsum(accx[k]);
+				ay[i + k] = hsum(accy[k]);
+			}
+		}
+
+		template<typename Soft>
+		GRAV_TARGET("avx512f")
+		void group_avx512(const float* x, const float* y, const float* mass, size_t count, const float* px, const float* py, size_t targets, float length, float* ax, float* ay) {
+			const size_t padded = ( count + 15 ) & ~size_t(15);
+			size_t i = 0;
+			for (; i + group_block <= targets; i += group_block) group_block_avx512<Soft, group_block>(x, y, mass, padded, px, py, i, length, ax, ay);
+			for (; i < targets; i++) group_block_avx512<Soft, 1>(x, y, mass, padded, px, py, i, length, ax, ay);
+		}
+
+		//       ;     ,   
+		template<typename Soft>
+		GRAV_TARGET("avx2,fma")
+		void jerk_avx2(const float* x, const float* y, const float* vx, const float* vy, const float* mass, size_t n,
+			const uint32_t* targets, size_t count, float length, float* ax, float* ay, float* jx, float* jy) {
+			const __m256 g = _mm256_set1_ps(G), zero = _mm256_setzero_ps();
+			const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+			for (size_t k = 0; k < count; k++) {
+				const uint32_t i = targets[k];
+				const __m256 xi = _mm256_set1_ps(x[i]), yi = _mm256_set1_ps(y[i]), vxi = _mm256_set1_ps(vx[i]), vyi = _mm256_set1_ps(vy[i]);
+				__m256 accx = zero, accy = zero, jerkx = zero, jerky = zero;
+				for (size_t j = 0; j < n; j += 8) {
+					const __m256i tail = _mm256_cmpgt_epi32(_mm256_set1_epi32(int(std::min<size_t>(n - j, 8))), lanes);
+					__m256 dx = _mm256_sub_ps(_mm256_maskload_ps(x + j, tail), xi);
+					__m256 dy = _mm256_sub_ps(_mm256_maskload_ps(y + j, tail), yi);
+					__m256 dvx = _mm256_sub_ps(_mm256_maskload_ps(vx + j, tail), vxi);
+					__m256 dvy = _mm256_sub_ps(_mm256_maskload_ps(vy + j, tail), vyi);
+					__m256 r2 = _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx));
+					__m256 valid = _mm256_and_ps(_mm256_cmp_ps(r2, zero, _CMP_GT_OQ), _mm256_castsi256_ps(tail));
+					__m256 gm = _mm256_mul_ps(g, _mm256_maskload_ps(mass + j, tail));
+					__m256 f = _mm256_mul_ps(gm, _mm256_and_ps(inv_cube(Soft{}, r2, length), valid));
+					__m256 rv = _mm256_fmadd_ps(dy, dvy, _mm256_mul_ps(dx, dvx));
+					__m256 s = _mm256_mul_ps(_mm256_mul_ps(gm, _mm256_and_ps(slope(Soft{}, r2, length), valid)), rv);
+					accx = _mm256_fmadd_ps(dx, f, accx);
+					accy = _mm256_fmadd_ps(dy, f, accy);
+					jerkx = _mm256_fmadd_ps(dvx, f, _mm256_fmadd_ps(dx, s, jerkx));
+					jerky = _mm256_fmadd_ps(dvy, f, _mm256_fmadd_ps(dy, s, jerky));
+				}
+				ax[k] = hsum(accx);
+				ay[k] = hsum(accy);
+				jx[k] = hsum(jerkx);
+				jy[k] = hsum(jerky);
+			}
+		}
+
+		template<typename Soft>
+		GRAV_TARGET("avx512f")
+		void jerk_avx512(const float* x, const float* y, const float* vx, const float* vy, const float* mass, size_t n,
+			const uint32_t* targets, size_t count, float length, float* ax, float* ay, float* jx, float* jy) {
+			const __m512 g = _mm512_set1_ps(G), zero = _mm512_setzero_ps();
+			for (size_t k = 0; k < count; k++) {
+				const uint32_t i = targets[k];
+				const __m512 xi = _mm512_set1_ps(x[i]), yi = _mm512_set1_ps(y[i]), vxi = _mm512_set1_ps(vx[i]), vyi = _mm512_set1_ps(vy[i]);
+				__m512 accx = zero, accy = zero, jerkx = zero, jerky = zero;
+				for (size_t j = 0; j < n; j += 16) {
+					__mmask16 tail = n - j >= 16 ? __mmask16(0xFFFF) : __mmask16(( 1u << ( n - j ) ) - 1);
+					__m512 dx = _mm512_sub_ps(_mm512_maskz_loadu_ps(tail, x + j), xi);
+					__m512 dy = _mm512_sub_ps(_mm512_maskz_loadu_ps(tail, y + j), yi);
+					__m512 dvx = _mm512_sub_ps(_mm512_maskz_loadu_ps(tail, vx + j), vxi);
+					__m512 dvy = _mm512_sub_ps(_mm512_maskz_loadu_ps(tail, vy + j), vyi);
+					__m512 r2 = _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dx, dx));
+					__mmask16 valid = _mm512_cmp_ps_mask(r2, zero, _CMP_GT_OQ) & tail;
+					__m512 gm = _mm512_mul_ps(g, _mm512_maskz_loadu_ps(tail, mass + j));
+					__m512 f = _mm512_mul_ps(gm, _mm512_maskz_mov_ps(valid, inv_cube(Soft{}, r2, length)));
+					__m512 rv = _mm512_fmadd_ps(dy, dvy, _mm512_mul_ps(dx, dvx));
+					__m512 s = _mm512_mul_ps(_mm512_mul_ps(gm, _mm512_maskz_mov_ps(valid, slope(Soft{}, r2, length))), rv);
+					accx = _mm512_fmadd_ps(dx, f, accx);
+					accy = _mm512_fmadd_ps(dy, f, accy);
+					jerkx = _mm512_fmadd_ps(dvx, f, _mm512_fmadd_ps(dx, s, jerkx));
+					jerky = _mm512_fmadd_ps(dvy, f, _mm512_fmadd_ps(dy, s, jerky));
+				}
+				ax[k] = hsum(accx);
+				ay[k] = hsum(accy);
+				jx[k] = hsum(jerkx);
+				jy[k] = hsum(jerky);
+			}
+		}
+
+		template<typename Soft>
+		DirectKernel direct_for(simd_level level) noexcept {
+			switch (level) {
+			case simd_level::avx512: return direct_avx512<Soft>;
+			case simd_level::avx2: return direct_avx2<Soft>;
+			default: return direct_rows<Soft, float>;
+			}
+		}
+
+		template<typename Soft>
+		PullKernel pull_for(simd_level level) noexcept {
+			switch (level) {
+			case simd_level::avx512: return pull_avx512<Soft>;
+			case simd_level::avx2: return pull_avx2<Soft>;
+			default: return pull_scalar<Soft>;
+			}
+		}
+
+		template<typename Soft>
+		JerkKernel jerk_for(simd_level level) noexcept {
+			switch (level) {
+			case simd_level::avx512: return jerk_avx512<Soft>;
+			case simd_level::avx2: return jerk_avx2<Soft>;
+			default: return jerk_rows<Soft, float>;
+			}
+		}
+
+		template<typename Soft>
+		GroupKernel group_for(simd_level level) noexcept {
+			switch (level) {
+			case simd_level::avx512: return group_avx512<Soft>;
+			case simd_level::avx2: return group_avx2<Soft>;
+			default: return group_rows<Soft, float>;
+			}
+		}
+	}
+
+	simd_level detect_simd() noexcept {
+		uint32_t r[4];
+		cpuid(0, 0, r);
+		if (r[0] < 7) return simd_level::scalar;
+		cpuid(1, 0, r);
+		bool osxsave = r[2] & ( 1u << 27 ), fma = r[2] & ( 1u << 12 );
+		if (!osxsave) return simd_level::scalar;
+		uint64_t xcr0 = xgetbv0();
+		cpuid(7, 0, r);
+		bool avx2 = r[1] & ( 1u << 5 ), avx512f = r[1] & ( 1u << 16 );
+		//     ymm ( 1-2)  zmm/k ( 5-7)
+		if (avx512f && ( xcr0 & 0xE6 ) == 0xE6) return simd_level::avx512;
+		if (avx2 && fma && ( xcr0 & 0x6 ) == 0x6) return simd_level::avx2;
+		return simd_level::scalar;
+	}
+
+	const char* simd_name(simd_level level) noexcept {
+		switch (level) {
+		case simd_level::avx512: return "AVX-512";
+		case simd_level::avx2: return "AVX2";
+		default: return "scalar";
+		}
+	}
+
+	//   ( , ) -   ,    
+	DirectKernel direct_kernel(simd_level level, softening_model model) noexcept {
+		return with_softening(model, [level](auto soft) { return direct_for<decltype(soft)>(level); });
+	}
+
+	PullKernel pull_kernel(simd_level level, softening_model model) noexcept {
+		return with_softening(model, [level](auto soft) { return pull_for<decltype(soft)>(level); });
+	}
+
+	GroupKernel group_kernel(simd_level level, softening_model model) noexcept {
+		return with_softening(model, [level](auto soft) { return group_for<decltype(soft)>(level); });
+	}
+
+	JerkKernel jerk_kernel(simd_level level, softening_model model) noexcept {
+		return with_softening(model, [level](auto soft) { return jerk_for<decltype(soft)>(level); });
+	}
+}
\ No newline at end of file
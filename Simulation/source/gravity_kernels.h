@@ -0,0 +1,100 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "body.h"
+#include "softening.h"
+
+namespace grav
+{
+	enum class simd_level { scalar, avx2, avx512 };
+
+	//   ,     (  CPUID)
+	simd_level detect_simd() noexcept;
+	const char* simd_name(simd_level) noexcept;
+
+	//    SIMD   ;  float   ,  double - 
+	template<typename Soft, typename Real>
+	void direct_rows(const Real* x, const Real* y, const Real* mass, size_t n, size_t begin, size_t end, float length, Real* ax, Real* ay, Real* phi) {
+		const Real g = G, h = length;
+		for (size_t i = begin; i < end; i++) {
+			Real accx = 0, accy = 0, pot = 0;
+			for (size_t j = 0; j < n; j++) {
+				Real dx = x[j] - x[i], dy = y[j] - y[i], r2 = dx * dx + dy * dy;
+				Real s = g * mass[j] * Soft::inv_cube(r2, h);
+				accx += dx * s;
+				accy += dy * s;
+				if (phi && r2 > 0) pot += mass[j] * Soft::potential(r2, h);
+			}
+			ax[i] = accx;
+			ay[i] = accy;
+			if (phi) phi[i] = g * pot;
+		}
+	}
+
+	//   [begin, end)        length;
+	//  phi  nullptr,      G sum m phi(r)   .
+	// x, y, mass      16
+	using DirectKernel = void(*)(const float* x, const float* y, const float* mass, size_t n, size_t begin, size_t end, float length, float* ax, float* ay, float* phi);
+	DirectKernel direct_kernel(simd_level, softening_model) noexcept;
+
+	//   (px, py)  [0, count)   G m d * inv_cube(r^2),   ax, ay;
+	//   ,   -    ( ),  
+	using PullKernel = void(*)(const float* x, const float* y, const float* mass, size_t count, float px, float py, float length, float& ax, float& ay);
+	PullKernel pull_kernel(simd_level, softening_model) noexcept;
+
+	//   (px[i], py[i]), i < targets,   [0, count)   ,   ax, ay;
+	//       16,    
+	template<typename Soft, typename Real>
+	void group_rows(const Real* x, const Real* y, const Real* mass, size_t count, const Real* px, const Real* py, size_t targets, float length, Real* ax, Real* ay) {
+		const Real g = G, h = length;
+		for (size_t i = 0; i < targets; i++) {
+			Real accx = 0, accy = 0;
+			for (size_t j = 0; j < count; j++) {
+				Real dx = x[j] - px[i], dy = y[j] - py[i];
+				Real s = g * mass[j] * Soft::inv_cube(dx * dx + dy * dy, h);
+				accx += dx * s;
+				accy += dy * s;
+			}
+			ax[i] = accx;
+			ay[i] = accy;
+		}
+	}
+
+	//      ,     :        
+	using GroupKernel = void(*)(const float* x, const float* y, const float* mass, size_t count, const float* px, const float* py, size_t targets, float length, float* ax, float* ay);
+	GroupKernel group_kernel(simd_level, softening_model) noexcept;
+
+	//     targets[k], k < count,   n :  k-   ax[k], ay[k], jx[k], jy[k];
+	//  da/dt = G m (dv * inv_cube + d (d . dv) * slope),    
+	template<typename Soft, typename Real>
+	void jerk_rows(const Real* x, const Real* y, const Real* vx, const Real* vy, const Real* mass, size_t n,
+		const uint32_t* targets, size_t count, float length, Real* ax, Real* ay, Real* jx, Real* jy) {
+		const Real g = G, h = length;
+		for (size_t k = 0; k < count; k++) {
+			const uint32_t i = targets[k];
+			Real accx = 0, accy = 0, jerkx = 0, jerky = 0;
+			for (size_t j = 0; j < n; j++) {
+				Real dx = x[j] - x[i], dy = y[j] - y[i], dvx = vx[j] - vx[i], dvy = vy[j] - vy[i];
+				Real r2 = dx * dx + dy * dy, gm = g * mass[j];
+				Real f = gm * Soft::inv_cube(r2, h), s = gm * Soft::slope(r2, h) * ( dx * dvx + dy * dvy );
+				accx += dx * f;
+				accy += dy * f;
+				jerkx += dvx * f + dx * s;
+				jerky += dvy * f + dy * s;
+			}
+			ax[k] = accx;
+			ay[k] = accy;
+			jx[k] = jerkx;
+			jy[k] = jerky;
+		}
+	}
+
+	//    float  SIMD;       ,    
+	using JerkKernel = void(*)(const float* x, const float* y, const float* vx, const float* vy, const float* mass, size_t n,
+		const uint32_t* targets, size_t count, float length, float* ax, float* ay, float* jx, float* jy);
+	JerkKernel jerk_kernel(simd_level, softening_model) noexcept;
+
+	//     
+	inline const simd_level active_simd = detect_simd();
+}
\ No newline at end of file
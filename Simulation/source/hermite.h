@@ -0,0 +1,219 @@
+#pragma once
+#include <algorithm>
+#include <concepts>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include "body_system.h"
+#include "direct.h"
+#include "index_map.h"
+#include "parallel.h"
+#include "softening.h"
+
+namespace grav
+{
+	//     (-):        ,
+	//      ,         
+	//    .   k   dt = h / 2^k,   BasicBlockTimesteps;   
+	//    ,     ,        
+	template<std::floating_point Real>
+	class BasicHermite {
+	public:
+		using system = BasicBodySystem<Real>;
+
+		//    ( ):
+		// dt = sqrt(eta * (|a| |a''| + |a'|^2) / (|a'| |a'''| + |a''|^2));   - eta * |a| / |a'|
+		float eta = 0.02f;
+
+		void invalidate() noexcept { m_valid = false; }
+
+		//        ;       
+		void remap(const IndexMap& map, size_t new_size) {
+			if (map.identity()) return;
+			if (m_count == map.old_size()) m_count = new_size;
+			std::vector<uint8_t> touched(new_size, 0);
+			for (size_t i = 0; i < map.old_size(); i++) if (!map.survives(int(i))) touched[map(int(i))] = 1;
+			map.apply(m_level, new_size, uint8_t(m_top));
+			map.apply(m_jx, new_size, Real(0));
+			map.apply(m_jy, new_size, Real(0));
+			for (size_t i = 0; i < new_size; i++) if (touched[i]) m_level[i] = uint8_t(m_top);
+		}
+
+		//     targets   ,   -  
+		void refresh(system& bodies, const Softening& softening, const std::vector<uint32_t>& targets) {
+			const size_t n = bodies.size();
+			m_jx.resize(n, Real(0));
+			m_jy.resize(n, Real(0));
+			m_time.assign(n, 0);
+			m_active = targets;
+			predict(bodies, 0, 0);
+			evaluate(bodies, softening);
+			Real* ax = bodies.ax(), * ay = bodies.ay();
+			for (size_t k = 0; k < targets.size(); k++) {
+				const uint32_t i = targets[k];
+				ax[i] = m_ax[k];
+				ay[i] = m_ay[k];
+				m_jx[i] = m_jxn[k];
+				m_jy[i] = m_jyn[k];
+			}
+		}
+
+		//        
+		size_t evaluations() const noexcept { return m_evaluations; }
+		//        
+		size_t global_evaluations() const noexcept { return m_global; }
+
+		//   h;  max_level > 0      h / 2^max_level,     h.
+		//  -      softening
+		void step(system& bodies, Real h, const Softening& softening, int max_level = 0) {
+			const size_t n = bodies.size();
+			const int top = std::clamp(max_level, 0, 20);
+			m_top = top;
+			m_level.resize(n, uint8_t(top));
+			m_jx.resize(n, Real(0));
+			m_jy.resize(n, Real(0));
+			m_time.assign(n, 0);
+			for (uint8_t& l : m_level) l = uint8_t(std::min<int>(l, top));
+
+			m_evaluations = 0;
+			if (!m_valid || m_count != n) {
+				m_active.resize(n);
+				for (uint32_t i = 0; i < n; i++) m_active[i] = i;
+				predict(bodies, 0, h);
+				evaluate(bodies, softening);
+				Real* ax = bodies.ax(), * ay = bodies.ay();
+				for (uint32_t i = 0; i < n; i++) {
+					ax[i] = m_ax[i];
+					ay[i] = m_ay[i];
+					m_jx[i] = m_jxn[i];
+					m_jy[i] = m_jyn[i];
+					Real a = std::hypot(ax[i], ay[i]), j = std::hypot(m_jx[i], m_jy[i]);
+					m_level[i] = uint8_t(level(j > 0 ? Real(eta) * a / j : h, h, top));
+				}
+			}
+
+			const uint32_t substeps = 1u << top;
+			const Real tau = h / Real(substeps);
+			for (uint32_t t = 1; t <= substeps; t++) {
+				m_active.clear();
+				for (uint32_t i = 0; i < n; i++) if (t % ( 1u << ( top - m_level[i] ) ) == 0) m_active.push_back(i);
+				if (m_active.empty()) continue;
+				predict(bodies, t, tau);
+				evaluate(bodies, softening);
+				correct(bodies, t, tau, h, top);
+			}
+
+			m_global = n * substeps;
+			m_valid = true;
+			m_count = n;
+		}
+
+	private:
+		//     -   ,  ,   BasicIntegrator
+		static constexpr size_t grain = 4096;
+
+		bool m_valid = false;
+		size_t m_count = 0;
+		size_t m_evaluations = 0, m_global = 0;
+		int m_top = 0;
+		std::vector<uint8_t> m_level;
+		std::vector<uint32_t> m_time;		// ,      
+		std::vector<Real> m_jx, m_jy;		//    ;    
+		std::vector<Real> m_px, m_py, m_pvx, m_pvy;
+		std::vector<Real> m_ax, m_ay, m_jxn, m_jyn;
+		std::vector<uint32_t> m_active;
+
+		//     wanted
+		static int level(Real wanted, Real h, int top) {
+			if (!( wanted < h )) return 0;
+			return std::min(top, int(std::ceil(std::log2(h / wanted))));
+		}
+
+		//      t    
+		void predict(const system& bodies, uint32_t t, Real tau) {
+			const size_t n = bodies.size();
+			m_px.resize(n);
+			m_py.resize(n);
+			m_pvx.resize(n);
+			m_pvy.resize(n);
+			const Real* x = bodies.x(), * y = bodies.y(), * vx = bodies.vx(), * vy = bodies.vy(), * ax = bodies.ax(), * ay = bodies.ay();
+			const Real* xl = bodies.compensated() ? bodies.x_lo() : nullptr, * yl = bodies.y_lo(), * vxl = bodies.vx_lo(), * vyl = bodies.vy_lo();
+			parallel_for(n, grain, [&, tau, t](size_t i) {
+				const Real dt = Real(t - m_time[i]) * tau, dt2 = dt * dt / 2, dt3 = dt2 * dt / 3;
+				Real px = x[i], py = y[i], pvx = vx[i], pvy = vy[i];
+				if (xl) {
+					px += xl[i];
+					py += yl[i];
+					pvx += vxl[i];
+					pvy += vyl[i];
+				}
+				m_px[i] = px + pvx * dt + ax[i] * dt2 + m_jx[i] * dt3;
+				m_py[i] = py + pvy * dt + ay[i] * dt2 + m_jy[i] * dt3;
+				m_pvx[i] = pvx + ax[i] * dt + m_jx[i] * dt2;
+				m_pvy[i] = pvy + ay[i] * dt + m_jy[i] * dt2;
+			});
+		}
+
+		//     m_active   
+		void evaluate(const system& bodies, const Softening& softening) {
+			const size_t k = m_active.size();
+			m_ax.resize(k);
+			m_ay.resize(k);
+			m_jxn.resize(k);
+			m_jyn.resize(k);
+			direct_jerks(m_px.data(), m_py.data(), m_pvx.data(), m_pvy.data(), bodies.mass(), bodies.size(), m_active, softening,
+				m_ax.data(), m_ay.data(), m_jxn.data(), m_jyn.data());
+			m_evaluations += k;
+		}
+
+		//    : v1 = v0 + (a0 + a1) dt / 2 + (j0 - j1) dt^2 / 12,
+		// x1 = x0 + (v0 + v1) dt / 2 + (a0 - a1) dt^2 / 12;      a''  a'''
+		void correct(system& bodies, uint32_t t, Real tau, Real h, int top) {
+			Real* x = bodies.x(), * y = bodies.y(), * vx = bodies.vx(), * vy = bodies.vy(), * ax = bodies.ax(), * ay = bodies.ay();
+			const bool compensated = bodies.compensated();
+			Real* xl = bodies.x_lo(), * yl = bodies.y_lo(), * vxl = bodies.vx_lo(), * vyl = bodies.vy_lo();
+			parallel_for(m_active.size(), grain, [&, t, tau, h, top](size_t k) {
+				const uint32_t i = m_active[k];
+				const Real dt = Real(t - m_time[i]) * tau, dt2 = dt * dt / 12;
+				const Real a0x = ax[i], a0y = ay[i], j0x = m_jx[i], j0y = m_jy[i];
+				const Real a1x = m_ax[k], a1y = m_ay[k], j1x = m_jxn[k], j1y = m_jyn[k];
+				const Real v0x = compensated ? vx[i] + vxl[i] : vx[i], v0y = compensated ? vy[i] + vyl[i] : vy[i];
+				const Real dvx = ( a0x + a1x ) * dt / 2 + ( j0x - j1x ) * dt2, dvy = ( a0y + a1y ) * dt / 2 + ( j0y - j1y ) * dt2;
+				const Real dx = ( 2 * v0x + dvx ) * dt / 2 + ( a0x - a1x ) * dt2, dy = ( 2 * v0y + dvy ) * dt / 2 + ( a0y - a1y ) * dt2;
+				if (compensated) {
+					compensated_add(vx[i], vxl[i], dvx);
+					compensated_add(vy[i], vyl[i], dvy);
+					compensated_add(x[i], xl[i], dx);
+					compensated_add(y[i], yl[i], dy);
+				}
+				else {
+					vx[i] += dvx;
+					vy[i] += dvy;
+					x[i] += dx;
+					y[i] += dy;
+				}
+				ax[i] = a1x;
+				ay[i] = a1y;
+				m_jx[i] = j1x;
+				m_jy[i] = j1y;
+				m_time[i] = t;
+				if (top == 0) return;
+
+				// a''  a'''     
+				const Real idt = 1 / dt, idt2 = idt * idt;
+				const Real sx = a0x - a1x, sy = a0y - a1y;
+				const Real a3x = ( 12 * sx + 6 * dt * ( j0x + j1x ) ) * idt2 * idt, a3y = ( 12 * sy + 6 * dt * ( j0y + j1y ) ) * idt2 * idt;
+				const Real a2x = ( -6 * sx - dt * ( 4 * j0x + 2 * j1x ) ) * idt2 + a3x * dt, a2y = ( -6 * sy - dt * ( 4 * j0y + 2 * j1y ) ) * idt2 + a3y * dt;
+				const Real a = std::hypot(a1x, a1y), j = std::hypot(j1x, j1y), s = std::hypot(a2x, a2y), c = std::hypot(a3x, a3y);
+				const Real below = j * c + s * s;
+				int next = level(below > 0 ? std::sqrt(Real(eta) * ( a * s + j * j ) / below) : h, h, top);
+				//         ,      
+				next = std::max(next, int(m_level[i]) - 1);
+				while (t % ( 1u << ( top - next ) ) != 0) next++;
+				m_level[i] = uint8_t(next);
+			});
+		}
+	};
+
+	using Hermite = BasicHermite<float>;
+}
\ No newline at end of file
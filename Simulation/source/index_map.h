@@ -0,0 +1,62 @@
+#pragma once
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <cstdint>
+
+namespace grav
+{
+	//    ->    ;     
+	class IndexMap {
+	public:
+		IndexMap() = default;
+		IndexMap(std::vector<int> to_new, std::vector<uint8_t> survives) : m_to_new(std::move(to_new)), m_survives(std::move(survives)) { }
+
+		//   
+		bool identity() const noexcept { return m_to_new.empty(); }
+
+		int operator()(int old) const noexcept {
+			if (old < 0 || identity()) return old;
+			return m_to_new[old];
+		}
+
+		//    ,    
+		bool survives(int old) const noexcept {
+			return identity() || m_survives[old];
+		}
+
+		//     (0  )
+		size_t old_size() const noexcept { return m_to_new.size(); }
+
+		//      ;    ,
+		//    (,    )  fill
+		template<typename T, typename Alloc>
+		void apply(std::vector<T, Alloc>& data, size_t new_size, const T& fill = T()) const {
+			if (identity()) {
+				data.resize(new_size, fill);
+				return;
+			}
+			std::vector<T, Alloc> moved(new_size, fill);
+			for (size_t i = 0; i < std::min(data.size(), m_to_new.size()); i++)
+				if (m_survives[i] && m_to_new[i] >= 0 && size_t(m_to_new[i]) < new_size) moved[m_to_new[i]] = data[i];
+			data = std::move(moved);
+		}
+
+		//  :  this,  next
+		IndexMap then(const IndexMap& next) const {
+			if (identity()) return next;
+			if (next.identity()) return *this;
+			std::vector<int> m(m_to_new.size());
+			std::vector<uint8_t> alive(m_to_new.size());
+			for (size_t i = 0; i < m.size(); i++) {
+				m[i] = next(m_to_new[i]);
+				alive[i] = m_survives[i] && next.survives(m_to_new[i]);
+			}
+			return IndexMap(std::move(m), std::move(alive));
+		}
+
+	private:
+		std::vector<int> m_to_new;
+		std::vector<uint8_t> m_survives;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,175 @@
+#pragma once
+#include <algorithm>
+#include <concepts>
+#include <string_view>
+#include <vector>
+#include "body_system.h"
+#include "index_map.h"
+#include "parallel.h"
+
+namespace grav
+{
+	// hermite -     (BasicHermite),    BasicIntegrator
+	enum class scheme { leapfrog, verlet, hermite };
+
+	inline const char* scheme_name(scheme s) {
+		switch (s) {
+		case scheme::leapfrog: return "leapfrog";
+		case scheme::verlet: return "verlet";
+		case scheme::hermite: return "hermite";
+		}
+		return "?";
+	}
+
+	inline bool parse_scheme(std::string_view name, scheme& s) {
+		for (scheme c : { scheme::leapfrog, scheme::verlet, scheme::hermite })
+			if (name == scheme_name(c)) {
+				s = c;
+				return true;
+			}
+		return false;
+	}
+
+	//    ; compute()   ax, ay   .
+	//      (compensated),    
+	template<std::floating_point Real>
+	class BasicIntegrator {
+	public:
+		using system = BasicBodySystem<Real>;
+
+		scheme method = scheme::leapfrog;
+
+		//      (  , )
+		void invalidate() noexcept { m_valid = false; }
+
+		//   :     ,     
+		void remap(const IndexMap& map, size_t new_size) noexcept {
+			if (m_count == map.old_size()) m_count = new_size;
+		}
+
+		template<typename Forces>
+		void step(system& bodies, Real h, Forces&& compute) {
+			if (!m_valid || m_count != bodies.size()) compute();
+			if (method == scheme::leapfrog) {
+				// kick-drift-kick
+				kick(bodies, Real(0.5) * h);
+				drift(bodies, h);
+				compute();
+				kick(bodies, Real(0.5) * h);
+			}
+			else {
+				// x += v h + a h^2 / 2,  v += (a + a') h / 2
+				const size_t n = bodies.size();
+				Real* x = bodies.x(), * y = bodies.y(), * vx = bodies.vx(), * vy = bodies.vy();
+				const Real* ax = bodies.ax(), * ay = bodies.ay();
+				m_ax.assign(ax, ax + n);
+				m_ay.assign(ay, ay + n);
+				const Real hh = Real(0.5) * h * h;
+				if (bodies.compensated()) {
+					Real* xl = bodies.x_lo(), * yl = bodies.y_lo(), * vxl = bodies.vx_lo(), * vyl = bodies.vy_lo();
+					parallel_for(n, grain, [=](size_t i) {
+						compensated_add(x[i], xl[i], ( vx[i] + vxl[i] ) * h + ax[i] * hh);
+						compensated_add(y[i], yl[i], ( vy[i] + vyl[i] ) * h + ay[i] * hh);
+					});
+					compute();
+					parallel_for(n, grain, [=, this](size_t i) {
+						compensated_add(vx[i], vxl[i], ( m_ax[i] + ax[i] ) * ( Real(0.5) * h ));
+						compensated_add(vy[i], vyl[i], ( m_ay[i] + ay[i] ) * ( Real(0.5) * h ));
+					});
+				}
+				else {
+					parallel_for(n, grain, [=](size_t i) {
+						x[i] += vx[i] * h + ax[i] * hh;
+						y[i] += vy[i] * h + ay[i] * hh;
+					});
+					compute();
+					parallel_for(n, grain, [=, this](size_t i) {
+						vx[i] += ( m_ax[i] + ax[i] ) * ( Real(0.5) * h );
+						vy[i] += ( m_ay[i] + ay[i] ) * ( Real(0.5) * h );
+					});
+				}
+			}
+			m_valid = true;
+			m_count = bodies.size();
+		}
+
+		// v += a h   i
+		static void kick(system& bodies, size_t i, Real h) {
+			if (bodies.compensated()) {
+				compensated_add(bodies.vx()[i], bodies.vx_lo()[i], bodies.ax()[i] * h);
+				compensated_add(bodies.vy()[i], bodies.vy_lo()[i], bodies.ay()[i] * h);
+			}
+			else {
+				bodies.vx()[i] += bodies.ax()[i] * h;
+				bodies.vy()[i] += bodies.ay()[i] * h;
+			}
+		}
+		static void kick(system& bodies, Real h) {
+			Real* vx = bodies.vx(), * vy = bodies.vy();
+			const Real* ax = bodies.ax(), * ay = bodies.ay();
+			if (bodies.compensated()) {
+				Real* vxl = bodies.vx_lo(), * vyl = bodies.vy_lo();
+				parallel_for(bodies.size(), grain, [=](size_t i) {
+					compensated_add(vx[i], vxl[i], ax[i] * h);
+					compensated_add(vy[i], vyl[i], ay[i] * h);
+				});
+				return;
+			}
+			parallel_for(bodies.size(), grain, [=](size_t i) {
+				vx[i] += ax[i] * h;
+				vy[i] += ay[i] * h;
+			});
+		}
+		static void drift(system& bodies, Real h) {
+			Real* x = bodies.x(), * y = bodies.y();
+			const Real* vx = bodies.vx(), * vy = bodies.vy();
+			if (bodies.compensated()) {
+				Real* xl = bodies.x_lo(), * yl = bodies.y_lo();
+				const Real* vxl = bodies.vx_lo(), * vyl = bodies.vy_lo();
+				parallel_for(bodies.size(), grain, [=](size_t i) {
+					compensated_add(x[i], xl[i], ( vx[i] + vxl[i] ) * h);
+					compensated_add(y[i], yl[i], ( vy[i] + vyl[i] ) * h);
+				});
+				return;
+			}
+			parallel_for(bodies.size(), grain, [=](size_t i) {
+				x[i] += vx[i] * h;
+				y[i] += vy[i] * h;
+			});
+		}
+
+	private:
+		//    -  ,    
+		static constexpr size_t grain = 16384;
+
+		bool m_valid = false;
+		size_t m_count = 0;
+		std::vector<Real> m_ax, m_ay;
+	};
+
+	using Integrator = BasicIntegrator<float>;
+
+	//  :         
+	class FixedStep {
+	public:
+		float step = 1.0f / 120.0f;
+		//      ;   ,    
+		int max_substeps = 8;
+
+		//       dt
+		int advance(float dt) noexcept {
+			m_accumulator += dt;
+			int steps = int(m_accumulator / step);
+			if (steps > max_substeps) {
+				steps = max_substeps;
+				m_accumulator = 0.0f;
+			}
+			else m_accumulator -= steps * step;
+			return steps;
+		}
+		void reset() noexcept { m_accumulator = 0.0f; }
+
+	private:
+		float m_accumulator = 0.0f;
+	};
+}
\ No newline at end of file
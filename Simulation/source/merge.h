@@ -0,0 +1,100 @@
+#pragma once
+#include <algorithm>
+#include <concepts>
+#include <numeric>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include "body_system.h"
+#include "collision.h"
+#include "index_map.h"
+
+namespace grav
+{
+	//   :     (A  B,   C),
+	//         (  -   ),
+	//       .
+	// times (  ) -       :    
+	//   ,    ,       ,   -  
+	template<std::floating_point Real>
+	class BasicMergeResolver {
+	public:
+		IndexMap resolve(BasicBodySystem<Real>& bodies, const std::vector<CollisionPair>& pairs, const std::vector<Real>& times = {}) {
+			if (pairs.empty()) return IndexMap();
+			const size_t n = bodies.size();
+			m_parent.resize(n);
+			std::iota(m_parent.begin(), m_parent.end(), 0u);
+			for (auto [a, b] : pairs) unite(a, b);
+
+			Real* mass = bodies.mass();
+			//     
+			m_winner.resize(n);
+			m_total.assign(n, Real(0));
+			for (uint32_t i = 0; i < n; i++) m_winner[i] = i;
+			for (uint32_t i = 0; i < n; i++) {
+				uint32_t root = find(i);
+				uint32_t& w = m_winner[root];
+				if (mass[i] > mass[w] || ( mass[i] == mass[w] && i < w )) w = i;
+			}
+			for (uint32_t i = 0; i < n; i++) m_total[find(i)] += mass[i];
+			m_time.assign(n, Real(0));
+			if (!times.empty()) {
+				std::fill(m_time.begin(), m_time.end(), std::numeric_limits<Real>::infinity());
+				for (size_t k = 0; k < pairs.size(); k++) {
+					Real& t = m_time[find(pairs[k].first)];
+					t = std::min(t, times[k]);
+				}
+			}
+
+			m_keep.assign(n, 1);
+			for (uint32_t i = 0; i < n; i++) {
+				uint32_t root = find(i);
+				uint32_t w = m_winner[root];
+				if (i != w) {
+					m_keep[i] = 0;
+					continue;
+				}
+				if (m_total[root] == mass[w]) continue;
+				//  ,   v = v / ((m + m2) / m)    
+				auto big = bodies[w];
+				const evo::Vector2<Real> before = big.velocity;
+				big.velocity = big.velocity * ( big.mass / m_total[root] );
+				// x + v t + v' (h - t) = (x + (v - v') t) + v' h:        
+				if (m_time[root] > 0) big.position += ( before - big.velocity ) * m_time[root];
+				big.mass = m_total[root];
+				big.r = std::sqrt(big.mass) * Real(0.01);
+				//    ,      
+				if (bodies.compensated()) bodies.vx_lo()[w] = bodies.vy_lo()[w] = 0;
+			}
+
+			std::vector<int> remap;
+			bodies.compact(m_keep, remap);
+			for (uint32_t i = 0; i < n; i++) if (!m_keep[i]) remap[i] = remap[m_winner[find(i)]];
+			return IndexMap(std::move(remap), m_keep);
+		}
+
+	private:
+		std::vector<uint32_t> m_parent, m_winner;
+		std::vector<Real> m_total, m_time;
+		std::vector<uint8_t> m_keep;
+
+		uint32_t find(uint32_t i) {
+			while (m_parent[i] != i) {
+				m_parent[i] = m_parent[m_parent[i]];
+				i = m_parent[i];
+			}
+			return i;
+		}
+		void unite(uint32_t a, uint32_t b) {
+			a = find(a);
+			b = find(b);
+			if (a == b) return;
+			//    ,       
+			if (b < a) std::swap(a, b);
+			m_parent[b] = a;
+		}
+	};
+
+	using MergeResolver = BasicMergeResolver<float>;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include "body_system.h"
+#include "index_map.h"
+#include "parallel.h"
+#include "radix_sort.h"
+
+namespace grav
+{
+	// 16   v    : abcd -> 0a0b0c0d
+	inline uint32_t spread_bits(uint32_t v) noexcept {
+		v &= 0xFFFF;
+		v = ( v | ( v << 8 ) ) & 0x00FF00FF;
+		v = ( v | ( v << 4 ) ) & 0x0F0F0F0F;
+		v = ( v | ( v << 2 ) ) & 0x33333333;
+		v = ( v | ( v << 1 ) ) & 0x55555555;
+		return v;
+	}
+
+	//   spread_bits:   v   16 
+	inline uint32_t compact_bits(uint32_t v) noexcept {
+		v &= 0x55555555;
+		v = ( v | ( v >> 1 ) ) & 0x33333333;
+		v = ( v | ( v >> 2 ) ) & 0x0F0F0F0F;
+		v = ( v | ( v >> 4 ) ) & 0x00FF00FF;
+		v = ( v | ( v >> 8 ) ) & 0x0000FFFF;
+		return v;
+	}
+
+	//   65536x65536  Z-
+	inline uint32_t morton_code(uint32_t ix, uint32_t iy) noexcept {
+		return spread_bits(ix) | ( spread_bits(iy) << 1 );
+	}
+
+	// ,    :     
+	template<typename Real>
+	struct MortonSquare
+	{
+		Real x = 0, y = 0, side = 0;
+
+		bool contains(Real px, Real py) const noexcept {
+			return px >= x && py >= y && px <= x + side && py <= y + side;
+		}
+
+		uint32_t code(Real px, Real py) const noexcept {
+			const Real scale = Real(65535) / side;
+			return morton_code(uint32_t(( px - x ) * scale), uint32_t(( py - y ) * scale));
+		}
+	};
+
+	//    ,      margin    ;   
+	template<typename Real>
+	MortonSquare<Real> morton_codes(const BasicBodySystem<Real>& bodies, std::vector<uint32_t>& codes, Real margin = 0) {
+		const size_t n = bodies.size();
+		codes.resize(n);
+		if (n == 0) return {};
+		const Real* x = bodies.x(), * y = bodies.y();
+		Real lo_x = x[0], hi_x = x[0], lo_y = y[0], hi_y = y[0];
+		for (size_t i = 1; i < n; i++) {
+			lo_x = std::min(lo_x, x[i]);
+			hi_x = std::max(hi_x, x[i]);
+			lo_y = std::min(lo_y, y[i]);
+			hi_y = std::max(hi_y, y[i]);
+		}
+		const Real side = std::max({ hi_x - lo_x, hi_y - lo_y, Real(1e-6) });
+		const MortonSquare<Real> square{ lo_x - margin * side, lo_y - margin * side, side * ( 1 + 2 * margin ) };
+		parallel_for(n, [&](size_t i) { codes[i] = square.code(x[i], y[i]); });
+		return square;
+	}
+
+	//    Z-,        ;
+	//    ,    
+	class MortonSort {
+	public:
+		template<typename Real>
+		IndexMap sort(BasicBodySystem<Real>& bodies) {
+			const size_t n = bodies.size();
+			if (n < 2) return IndexMap();
+			morton_codes(bodies, m_codes);
+			m_order.resize(n);
+			for (uint32_t i = 0; i < n; i++) m_order[i] = i;
+			radix_sort(m_codes, m_order);
+
+			bool moved = false;
+			std::vector<int> to_new(n);
+			for (uint32_t i = 0; i < n; i++) {
+				to_new[m_order[i]] = int(i);
+				moved |= m_order[i] != i;
+			}
+			if (!moved) return IndexMap();
+			bodies.permute(m_order);
+			return IndexMap(std::move(to_new), std::vector<uint8_t>(n, 1));
+		}
+
+	private:
+		std::vector<uint32_t> m_codes, m_order;
+	};
+}
\ No newline at end of file
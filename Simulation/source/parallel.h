@@ -0,0 +1,37 @@
+#pragma once
+#include <EvoNDZ/util/thread_pool.h>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <cstddef>
+
+namespace grav
+{
+	//    (  );       
+	inline unsigned thread_count = std::max(1u, std::thread::hardware_concurrency());
+	//     
+	inline bool pin_threads = false;
+
+	//    thread_count - 1  :    ,     ,
+	//      thread_count  pin_threads (     )
+	inline evo::ThreadPool& thread_pool() {
+		static std::unique_ptr<evo::ThreadPool> pool;
+		if (!pool || pool->concurrency() != std::max(1u, thread_count) || pool->pinned() != pin_threads) {
+			pool.reset();
+			pool = std::make_unique<evo::ThreadPool>(std::max(1u, thread_count) - 1, pin_threads);
+		}
+		return *pool;
+	}
+
+	//  f(i)   i  [0, count),    grain    
+	template<typename F>
+	void parallel_for(size_t count, size_t grain, F&& f) {
+		thread_pool().parallel_for(0, count, grain, f);
+	}
+
+	//      :     ,      
+	template<typename F>
+	void parallel_for(size_t count, F&& f) {
+		parallel_for(count, count / ( 8 * size_t(std::max(1u, thread_count)) ) + 1, f);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,335 @@
+#include "pm.h"
+#include "body.h"
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace grav
+{
+	namespace
+	{
+		constexpr double pi = 3.14159265358979323846;
+
+		//    2  ; twiddle[k] = exp(-2 pi i k / n)  k < n / 2
+		void fft(std::complex<double>* a, int n, const std::vector<std::complex<double>>& twiddle, bool inverse) {
+			for (int i = 1, j = 0; i < n; i++) {
+				int bit = n >> 1;
+				for (; j & bit; bit >>= 1) j ^= bit;
+				j ^= bit;
+				if (i < j) std::swap(a[i], a[j]);
+			}
+			for (int len = 2; len <= n; len <<= 1) {
+				const int half = len / 2, step = n / len;
+				for (int i = 0; i < n; i += len)
+					for (int k = 0; k < half; k++) {
+						std::complex<double> w = inverse ? std::conj(twiddle[k * step]) : twiddle[k * step];
+						std::complex<double> u = a[i + k], v = a[i + k + half] * w;
+						a[i + k] = u + v;
+						a[i + k + half] = u - v;
+					}
+			}
+		}
+
+		//  : ,  ,      ( )
+		void fft2d(std::vector<std::complex<double>>& data, int n, bool inverse) {
+			std::vector<std::complex<double>> twiddle(n / 2);
+			for (int k = 0; k < n / 2; k++) twiddle[k] = std::polar(1.0, -2.0 * pi * k / n);
+			parallel_for(size_t(n), [&](size_t row) { fft(&data[row * n], n, twiddle, inverse); });
+			parallel_for(size_t(n), [&](size_t col) {
+				std::vector<std::complex<double>> column(n);
+				for (int r = 0; r < n; r++) column[r] = data[size_t(r) * n + col];
+				fft(column.data(), n, twiddle, inverse);
+				for (int r = 0; r < n; r++) data[size_t(r) * n + col] = column[r];
+			});
+		}
+
+		//          (    )
+		struct cic
+		{
+			int i0, i1;
+			double f;
+		};
+
+		cic weights(double u, int n, bool periodic) {
+			cic c;
+			if (periodic) {
+				double base = std::floor(u);
+				c.f = u - base;
+				c.i0 = int(( int64_t(base) % n + n ) % n);
+				c.i1 = ( c.i0 + 1 ) % n;
+				return c;
+			}
+			u = std::clamp(u, 0.0, double(n - 1));
+			c.i0 = std::min(int(u), n - 2);
+			c.f = u - c.i0;
+			c.i1 = c.i0 + 1;
+			return c;
+		}
+	}
+
+	void ParticleMesh::prepare_green(int n, int size, double h, double s) {
+		const bool periodic = boundary == mesh_boundary::periodic;
+		if (m_green_grid == n && m_green_size == size && m_green_boundary == boundary && m_green_box == box && m_green_split == float(s))
+			return;
+		m_green_grid = n;
+		m_green_size = size;
+		m_green_boundary = boundary;
+		m_green_box = box;
+		m_green_split = float(s);
+		m_green.assign(size_t(size) * size, 0.0);
+
+		if (periodic) {
+			//  - 1/r  2 pi / k,   erf(r / s) / r - (2 pi / k) erfc(k s / 2)
+			const double dk = 2.0 * pi / ( n * h );
+			for (int j = 0; j < n; j++)
+				for (int i = 0; i < n; i++) {
+					double kx = dk * ( i < n / 2 ? i : i - n ), ky = dk * ( j < n / 2 ? j : j - n );
+					double k = std::hypot(kx, ky);
+					if (k == 0.0) continue;
+					double g = -2.0 * pi * G / k;
+					if (s > 0.0) g *= std::erfc(k * s / 2.0);
+					m_green[size_t(j) * n + i] = g / ( h * h );
+				}
+		}
+		else {
+			//  :       ,   
+			for (int j = 0; j < size; j++)
+				for (int i = 0; i < size; i++) {
+					double dx = h * ( i < n ? i : i - size ), dy = h * ( j < n ? j : j - size );
+					double r = std::hypot(dx, dy), g;
+					if (r > 0.0) g = -G * ( s > 0.0 ? std::erf(r / s) : 1.0 ) / r;
+					//  :  erf(r / s) / r,   1/r  
+					else g = s > 0.0 ? -G * 2.0 / ( s * std::sqrt(pi) ) : -G * 4.0 * std::log(1.0 + std::sqrt(2.0)) / h;
+					m_green[size_t(j) * size + i] = g;
+				}
+			fft2d(m_green, size, false);
+		}
+
+		//      0    - ,        
+		std::vector<complex> unit(m_green);
+		fft2d(unit, size, true);
+		const double norm = 1.0 / ( double(size) * size );
+		m_self[0] = unit[0].real() * norm;
+		m_self[1] = unit[1].real() * norm;
+		m_self[2] = unit[size_t(size) + 1].real() * norm;
+	}
+
+	//    cutoff * s    ,   ;   -  softening,    .
+	//  -  ,  -  targets ,  ,    
+	void ParticleMesh::short_range(const BodySystem& bodies, double s, const std::vector<uint32_t>* targets) {
+		const size_t n = bodies.size();
+		const bool periodic = boundary == mesh_boundary::periodic;
+		const float width = 2.0f * box;
+		const double rc = cutoff * s;
+		const int cells = std::clamp(int(width / rc), 1, 4096);
+		const float cell = width / cells;
+		const float* x = bodies.x(), * y = bodies.y(), * m = bodies.mass();
+
+		//        ,  ;
+		//     ,       
+		auto cell_of = [&](float v) {
+			int c = int(std::floor(( v + box ) / cell));
+			return periodic ? ( c % cells + cells ) % cells : std::clamp(c, 0, cells - 1);
+		};
+		m_cell_start.assign(size_t(cells) * cells + 1, 0);
+		m_cell_bodies.resize(n);
+		for (size_t i = 0; i < n; i++) m_cell_start[size_t(cell_of(y[i])) * cells + cell_of(x[i]) + 1]++;
+		for (size_t c = 1; c < m_cell_start.size(); c++) m_cell_start[c] += m_cell_start[c - 1];
+		{
+			std::vector<uint32_t> fill(m_cell_start.begin(), m_cell_start.end() - 1);
+			for (uint32_t i = 0; i < n; i++) m_cell_bodies[fill[size_t(cell_of(y[i])) * cells + cell_of(x[i])]++] = i;
+		}
+		m_sx.resize(n);
+		m_sy.resize(n);
+		m_sm.resize(n);
+		for (size_t k = 0; k < n; k++) {
+			m_sx[k] = x[m_cell_bodies[k]];
+			m_sy[k] = y[m_cell_bodies[k]];
+			m_sm[k] = m[m_cell_bodies[k]];
+		}
+
+		//    erfc(q) + 2 q exp(-q^2) / sqrt(pi)   q^2   
+		constexpr int samples = 4096;
+		const float scale = float(samples / ( cutoff * cutoff * s * s ));
+		std::vector<float> share(samples + 2);
+		for (int k = 0; k <= samples + 1; k++) {
+			double q = std::sqrt(double(k) / samples) * cutoff;
+			share[k] = float(std::erfc(q) + 2.0 / std::sqrt(pi) * q * std::exp(-q * q));
+		}
+		//   - erfc(q)   
+		std::vector<float> tail(potential ? samples + 2 : 0);
+		for (size_t k = 0; k < tail.size(); k++) tail[k] = float(std::erfc(std::sqrt(double(k) / samples) * cutoff));
+		const float rc2 = float(rc * rc);
+		//         -        
+		const bool few = periodic && cells < 3;
+
+		std::atomic<size_t> pairs = 0;
+		const float length = softening.length;
+		with_softening(softening.model, [&](auto soft) {
+			using Soft = decltype(soft);
+			parallel_for(targets ? targets->size() : n, [&](size_t k) {
+				const uint32_t i = targets ? ( *targets )[k] : m_cell_bodies[k];
+				const float xi = x[i], yi = y[i];
+				const int cx = cell_of(xi), cy = cell_of(yi);
+				double ax = 0.0, ay = 0.0, phi = 0.0;
+				size_t count = 0;
+				auto visit = [&](int vx, int vy, float shift_x, float shift_y) {
+					size_t c = size_t(vy) * cells + vx;
+					float accx = 0.0f, accy = 0.0f, pot = 0.0f;
+					for (uint32_t j = m_cell_start[c]; j < m_cell_start[c + 1]; j++) {
+						float dx = m_sx[j] + shift_x - xi, dy = m_sy[j] + shift_y - yi;
+						if (few) {
+							dx -= width * std::round(dx / width);
+							dy -= width * std::round(dy / width);
+						}
+						float r2 = dx * dx + dy * dy;
+						if (r2 == 0.0f || r2 >= rc2) continue;
+						float t = r2 * scale;
+						int slot = int(t);
+						float f = G * m_sm[j] * ( share[slot] + ( share[slot + 1] - share[slot] ) * ( t - slot ) ) * Soft::inv_cube(r2, length);
+						accx += dx * f;
+						accy += dy * f;
+						if (potential) pot += m_sm[j] * ( tail[slot] + ( tail[slot + 1] - tail[slot] ) * ( t - slot ) ) * Soft::potential(r2, length);
+						count++;
+					}
+					ax += accx;
+					ay += accy;
+					phi += pot;
+				};
+				if (few) {
+					for (int vy = 0; vy < cells; vy++)
+						for (int vx = 0; vx < cells; vx++) visit(vx, vy, 0.0f, 0.0f);
+				}
+				else for (int dy = -1; dy <= 1; dy++)
+					for (int dx = -1; dx <= 1; dx++) {
+						int vx = cx + dx, vy = cy + dy;
+						float shift_x = 0.0f, shift_y = 0.0f;
+						//   :    -    ,    
+						if (vx < 0 || vx >= cells || vy < 0 || vy >= cells) {
+							if (!periodic) continue;
+							if (vx < 0) { vx += cells; shift_x = -width; }
+							if (vx >= cells) { vx -= cells; shift_x = width; }
+							if (vy < 0) { vy += cells; shift_y = -width; }
+							if (vy >= cells) { vy -= cells; shift_y = width; }
+						}
+						visit(vx, vy, shift_x, shift_y);
+					}
+				m_ax[i] += float(ax);
+				m_ay[i] += float(ay);
+				if (potential) m_phi[i] += float(G * phi);
+				pairs.fetch_add(count, std::memory_order_relaxed);
+			});
+		});
+		m_interactions += pairs;
+	}
+
+	void ParticleMesh::run(BodySystem& bodies, const std::vector<uint32_t>* targets) {
+		const size_t count = bodies.size();
+		m_interactions = targets ? targets->size() : count;
+		m_ax.assign(count, 0.0f);
+		m_ay.assign(count, 0.0f);
+		m_phi.assign(potential ? count : 0, 0.0f);
+		if (count == 0) return;
+
+		int n = 16;
+		while (n * 2 <= std::min(grid, 4096)) n *= 2;
+		const bool periodic = boundary == mesh_boundary::periodic;
+		const int size = periodic ? n : 2 * n;
+		const double h = 2.0 * box / n;
+		const double s = p3m ? split * h : 0.0;
+		prepare_green(n, size, h, s);
+
+		//  :     ,       
+		const float* x = bodies.x(), * y = bodies.y(), * m = bodies.mass();
+		auto cloud = [&](size_t i) {
+			return std::make_pair(weights(( x[i] + box ) / h - 0.5, n, periodic), weights(( y[i] + box ) / h - 0.5, n, periodic));
+		};
+		const size_t threads = std::max<size_t>(1, std::min<size_t>(thread_count, count / 1024 + 1));
+		m_partial.resize(threads);
+		parallel_for(threads, [&](size_t t) {
+			std::vector<double>& rho = m_partial[t];
+			rho.assign(size_t(n) * n, 0.0);
+			for (size_t i = count * t / threads; i < count * ( t + 1 ) / threads; i++) {
+				auto [cx, cy] = cloud(i);
+				rho[size_t(cy.i0) * n + cx.i0] += m[i] * ( 1 - cx.f ) * ( 1 - cy.f );
+				rho[size_t(cy.i0) * n + cx.i1] += m[i] * cx.f * ( 1 - cy.f );
+				rho[size_t(cy.i1) * n + cx.i0] += m[i] * ( 1 - cx.f ) * cy.f;
+				rho[size_t(cy.i1) * n + cx.i1] += m[i] * cx.f * cy.f;
+			}
+		});
+		m_field.assign(size_t(size) * size, 0.0);
+		parallel_for(size_t(n), [&](size_t row) {
+			for (int i = 0; i < n; i++) {
+				double sum = 0.0;
+				for (size_t t = 0; t < threads; t++) sum += m_partial[t][row * n + i];
+				m_field[row * size + i] = sum;
+			}
+		});
+
+		//  -     
+		fft2d(m_field, size, false);
+		for (size_t k = 0; k < m_field.size(); k++) m_field[k] *= m_green[k];
+		fft2d(m_field, size, true);
+		const double norm = 1.0 / ( double(size) * size );
+		m_potential.resize(size_t(n) * n);
+		for (int j = 0; j < n; j++)
+			for (int i = 0; i < n; i++) m_potential[size_t(j) * n + i] = m_field[size_t(j) * size + i].real() * norm;
+
+		//    -     ,     
+		m_ax_grid.resize(size_t(n) * n);
+		m_ay_grid.resize(size_t(n) * n);
+		auto at = [&](int i, int j) {
+			if (periodic) {
+				i = ( i % n + n ) % n;
+				j = ( j % n + n ) % n;
+			}
+			else {
+				i = std::clamp(i, 0, n - 1);
+				j = std::clamp(j, 0, n - 1);
+			}
+			return m_potential[size_t(j) * n + i];
+		};
+		parallel_for(size_t(n), [&](size_t row) {
+			const int j = int(row);
+			for (int i = 0; i < n; i++) {
+				m_ax_grid[row * n + i] = -( 8.0 * ( at(i + 1, j) - at(i - 1, j) ) - ( at(i + 2, j) - at(i - 2, j) ) ) / ( 12.0 * h );
+				m_ay_grid[row * n + i] = -( 8.0 * ( at(i, j + 1) - at(i, j - 1) ) - ( at(i, j + 2) - at(i, j - 2) ) ) / ( 12.0 * h );
+			}
+		});
+
+		//       ,    
+		parallel_for(targets ? targets->size() : count, [&](size_t k) {
+			const size_t i = targets ? ( *targets )[k] : k;
+			auto [cx, cy] = cloud(i);
+			auto sample = [&](const std::vector<double>& g) {
+				return g[size_t(cy.i0) * n + cx.i0] * ( 1 - cx.f ) * ( 1 - cy.f ) + g[size_t(cy.i0) * n + cx.i1] * cx.f * ( 1 - cy.f )
+					+ g[size_t(cy.i1) * n + cx.i0] * ( 1 - cx.f ) * cy.f + g[size_t(cy.i1) * n + cx.i1] * cx.f * cy.f;
+			};
+			m_ax[i] = float(sample(m_ax_grid));
+			m_ay[i] = float(sample(m_ay_grid));
+			if (!potential) return;
+			//        ,      
+			const double sx = ( 1 - cx.f ) * ( 1 - cx.f ) + cx.f * cx.f, dx = 2 * cx.f * ( 1 - cx.f );
+			const double sy = ( 1 - cy.f ) * ( 1 - cy.f ) + cy.f * cy.f, dy = 2 * cy.f * ( 1 - cy.f );
+			const double self = sx * sy * m_self[0] + ( dx * sy + sx * dy ) * m_self[1] + dx * dy * m_self[2];
+			m_phi[i] = float(sample(m_potential) - m[i] * self);
+		});
+
+		if (p3m) short_range(bodies, s, targets);
+	}
+
+	void ParticleMesh::compute(BodySystem& bodies) {
+		run(bodies);
+		std::copy(m_ax.begin(), m_ax.end(), bodies.ax());
+		std::copy(m_ay.begin(), m_ay.end(), bodies.ay());
+	}
+
+	void ParticleMesh::compute(BodySystem& bodies, const std::vector<uint32_t>& targets) {
+		run(bodies, &targets);
+		for (uint32_t i : targets) {
+			bodies.ax()[i] = m_ax[i];
+			bodies.ay()[i] = m_ay[i];
+		}
+	}
+}
\ No newline at end of file
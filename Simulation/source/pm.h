@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include <complex>
+#include <cstdint>
+#include "body_system.h"
+#include "softening.h"
+
+namespace grav
+{
+	//  :  (    )   (  )
+	enum class mesh_boundary { periodic, isolated };
+
+	//    :       (CIC),  - 
+	//     ,  -   ,    .
+	//  P3M      split ,    
+	class ParticleMesh {
+	public:
+		//   ,  
+		int grid = 256;
+		mesh_boundary boundary = mesh_boundary::isolated;
+		//   [-box, box]^2,   border 
+		float box = 100.0f;
+
+		//   :      cutoff * split 
+		bool p3m = false;
+		float split = 1.5f;
+		float cutoff = 4.0f;
+		//    ;       
+		Softening softening;
+		//     :           
+		bool potential = false;
+
+		void compute(BodySystem& bodies);
+		//     targets:       ,
+		//         -    
+		void compute(BodySystem& bodies, const std::vector<uint32_t>& targets);
+
+		//           
+		size_t interactions() const noexcept { return m_interactions; }
+		//  G sum m phi(r)       potential;    -     
+		const std::vector<float>& potentials() const noexcept { return m_phi; }
+
+	private:
+		using complex = std::complex<double>;
+
+		//        
+		std::vector<complex> m_green;
+		int m_green_grid = 0, m_green_size = 0;
+		mesh_boundary m_green_boundary = mesh_boundary::isolated;
+		float m_green_box = 0.0f, m_green_split = -1.0f;
+		double m_self[3] = {};	//     (0, 0), (1, 0)  (1, 1) 
+
+		std::vector<std::vector<double>> m_partial;	//      
+		std::vector<complex> m_field;
+		std::vector<double> m_potential, m_ax_grid, m_ay_grid;
+		std::vector<float> m_ax, m_ay, m_phi;
+		std::vector<uint32_t> m_cell_start, m_cell_bodies;
+		std::vector<float> m_sx, m_sy, m_sm;	//      
+		size_t m_interactions = 0;
+
+		void prepare_green(int n, int size, double h, double s);
+		void short_range(const BodySystem& bodies, double s, const std::vector<uint32_t>* targets);
+		void run(BodySystem& bodies, const std::vector<uint32_t>* targets = nullptr);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include "parallel.h"
+
+namespace grav
+{
+	//     (, )  32- ,    8 .
+	//            , 
+	//      
+	template<typename Value>
+	void radix_sort(std::vector<uint32_t>& keys, std::vector<Value>& values) {
+		const size_t n = keys.size();
+		if (n < 2) return;
+		const size_t chunks = std::max<size_t>(1, std::min<size_t>(thread_count, n / 4096 + 1));
+		std::vector<uint32_t> keys_tmp(n);
+		std::vector<Value> values_tmp(n);
+		std::vector<size_t> offsets(chunks * 256);
+
+		for (int shift = 0; shift < 32; shift += 8) {
+			std::fill(offsets.begin(), offsets.end(), 0);
+			parallel_for(chunks, [&](size_t c) {
+				size_t* hist = &offsets[c * 256];
+				for (size_t i = n * c / chunks; i < n * ( c + 1 ) / chunks; i++) hist[( keys[i] >> shift ) & 0xFF]++;
+			});
+			//      -    
+			size_t same = 0;
+			for (size_t c = 0; c < chunks; c++) same += offsets[c * 256 + ( ( keys[0] >> shift ) & 0xFF )];
+			if (same == n) continue;
+
+			//     :   ,   -  
+			size_t total = 0;
+			for (int d = 0; d < 256; d++)
+				for (size_t c = 0; c < chunks; c++) {
+					size_t count = offsets[c * 256 + d];
+					offsets[c * 256 + d] = total;
+					total += count;
+				}
+			parallel_for(chunks, [&](size_t c) {
+				size_t* place = &offsets[c * 256];
+				for (size_t i = n * c / chunks; i < n * ( c + 1 ) / chunks; i++) {
+					size_t to = place[( keys[i] >> shift ) & 0xFF]++;
+					keys_tmp[to] = keys[i];
+					values_tmp[to] = values[i];
+				}
+			});
+			keys.swap(keys_tmp);
+			values.swap(values_tmp);
+		}
+	}
+}
\ No newline at end of file
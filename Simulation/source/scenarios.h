@@ -0,0 +1,112 @@
+#pragma once
+#include <EvoNDZ/math/vector2.h>
+#include <random>
+#include <string_view>
+#include <cmath>
+#include "body.h"
+#include "body_system.h"
+
+namespace grav
+{
+	//     ,       seed
+	enum class scenario { uniform_box, plummer, colliding_discs, merging_cloud };
+
+	inline const char* scenario_name(scenario s) {
+		switch (s) {
+		case scenario::uniform_box: return "uniform_box";
+		case scenario::plummer: return "plummer";
+		case scenario::colliding_discs: return "colliding_discs";
+		case scenario::merging_cloud: return "merging_cloud";
+		}
+		return "?";
+	}
+
+	inline bool parse_scenario(std::string_view name, scenario& s) {
+		for (scenario c : { scenario::uniform_box, scenario::plummer, scenario::colliding_discs, scenario::merging_cloud })
+			if (name == scenario_name(c)) {
+				s = c;
+				return true;
+			}
+		return false;
+	}
+
+	// count   mass; size -  ,  border  ;
+	//     float,           
+	template<typename Real>
+	void generate(scenario s, BasicBodySystem<Real>& bodies, size_t count, unsigned seed, float size = 100.0f, float mass = 1.0f) {
+		constexpr float pi = 3.14159265f;
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		bodies.clear();
+		auto add = [&bodies](const body& b) { bodies.push_back(basic_body<Real>(b)); };
+
+		switch (s) {
+		//    S:      size,  
+		case scenario::uniform_box:
+			for (size_t i = 0; i < count; i++)
+				add(body(evo::Vector2f(unit(rng) * size - size / 2, unit(rng) * size - size / 2), mass));
+			break;
+
+		//   (Aarseth, Henon, Wielen 1974),   ;
+		//   G = M = a = 1,     size / 8    count * mass
+		case scenario::plummer: {
+			const float a = size / 8;
+			const float v_scale = std::sqrt(G * mass * float(count) / a);
+			auto isotropic = [&](float length) {
+				float z = 2.0f * unit(rng) - 1.0f, phi = 2.0f * pi * unit(rng);
+				float rxy = length * std::sqrt(1.0f - z * z);
+				return evo::Vector2f(rxy * std::cos(phi), rxy * std::sin(phi));
+			};
+			for (size_t i = 0; i < count; i++) {
+				//    ,    10 a
+				float r;
+				do r = 1.0f / std::sqrt(std::pow(std::max(unit(rng), 1e-6f), -2.0f / 3.0f) - 1.0f);
+				while (r > 10.0f);
+				//  -     g(q) = q^2 (1 - q^2)^3.5
+				float q, g;
+				do {
+					q = unit(rng);
+					g = 0.1f * unit(rng);
+				} while (g > q * q * std::pow(1.0f - q * q, 3.5f));
+				float v = q * std::sqrt(2.0f) * std::pow(1.0f + r * r, -0.25f);
+				body b(isotropic(r) * a, mass);
+				b.velocity = isotropic(v) * v_scale;
+				add(b);
+			}
+			break;
+		}
+
+		//       ,     
+		case scenario::colliding_discs: {
+			const float radius = size / 8;
+			const size_t half = count / 2;
+			for (int d = 0; d < 2; d++) {
+				const size_t n = d == 0 ? half : count - half;
+				const float disc_mass = mass * float(n);
+				const float side = d == 0 ? -1.0f : 1.0f;
+				const evo::Vector2f center(side * radius * 2.0f, side * radius * 0.5f);
+				const evo::Vector2f drift(-side * std::sqrt(G * disc_mass / radius) * 0.5f, 0.0f);
+				for (size_t i = 0; i < n; i++) {
+					//   ,      
+					float r = radius * std::sqrt(std::max(unit(rng), 1e-4f)), phi = 2.0f * pi * unit(rng);
+					evo::Vector2f offset(r * std::cos(phi), r * std::sin(phi));
+					float v = std::sqrt(G * disc_mass * ( r / radius ) * ( r / radius ) / r);
+					body b(center + offset, mass);
+					b.velocity = drift + evo::Vector2f(-offset.y, offset.x) * ( v / r );
+					add(b);
+				}
+			}
+			break;
+		}
+
+		//   :         ,
+		//         ,   
+		case scenario::merging_cloud: {
+			const float side = 12.0f * body(evo::Vector2f::Zero(), mass).r * std::sqrt(float(count));
+			for (size_t i = 0; i < count; i++)
+				add(body(evo::Vector2f(unit(rng) * side - side / 2, unit(rng) * side - side / 2), mass));
+			break;
+		}
+		}
+	}
+}
\ No newline at end of file
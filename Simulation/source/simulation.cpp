@@ -0,0 +1,263 @@
+#include "simulation.h"
+#include "direct.h"
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <type_traits>
+
+namespace grav
+{
+	template<std::floating_point Real>
+	IndexMap BasicSimulation<Real>::step(Real h) {
+		//  ;        ,   
+		if (continuous) find_impacts(h);
+		else {
+			m_impacts.clear();
+			if (!m_pairs_ready) find_pairs();
+		}
+		m_pairs_ready = false;
+		m_tree_ready = false;
+		m_phi_ready = false;
+		IndexMap map = m_merges.resolve(bodies, m_pairs, m_impacts);
+		if (!map.identity()) {
+			stats.merges += map.old_size() - bodies.size();
+			integrator.remap(map, bodies.size());
+			blocks.remap(map, bodies.size());
+			hermite.remap(map, bodies.size());
+			m_sweep.remap(map, bodies.size());
+			tree.remap(map, bodies.size());
+			refresh_merged(map);
+		}
+
+		//    -   ;     ,   
+		if (reorder_interval > 0 && ++m_since_reorder >= reorder_interval) {
+			m_since_reorder = 0;
+			IndexMap order = m_morton.sort(bodies);
+			if (!order.identity()) {
+				blocks.remap(order, bodies.size());
+				hermite.remap(order, bodies.size());
+				m_sweep.remap(order, bodies.size());
+				tree.remap(order, bodies.size());
+				map = map.then(order);
+			}
+		}
+
+		//      ;   ,    .
+		//         -        
+		m_phi_due = diagnostics.due() && integrator.method != scheme::hermite && !block_steps;
+		if (integrator.method != scheme::hermite) hermite.invalidate();
+		if (integrator.method == scheme::hermite) {
+			hermite.step(bodies, h, softening, block_steps ? blocks.max_level : 0);
+			stats.force_evaluations += hermite.evaluations();
+			stats.interactions += bodies.empty() ? 0 : hermite.evaluations() * ( bodies.size() - 1 );
+		}
+		else if (block_steps) blocks.step(bodies, h, [this](const std::vector<uint32_t>& active) { compute_forces(&active); });
+		else integrator.step(bodies, h, [this]() {
+			//      ,   , -      
+			evo::TaskGraph graph;
+			graph.add([this]() { compute_forces(); });
+			//       ,   
+			if (!continuous) graph.add([this]() { find_pairs(); });
+			graph.run(thread_pool());
+			m_pairs_ready = !continuous;
+		});
+
+		//  
+		for (auto a : bodies) if (a.position.x >= border || a.position.x <= -border || a.position.y >= border || a.position.y <= -border) {
+			a.position += -a.velocity * h;
+			a.velocity = -a.velocity / Real(10);
+			invalidate_forces();
+		}
+		m_phi_due = false;
+		stats.steps++;
+		stats.body_steps += bodies.size();
+		if (diagnostics.tick()) diagnostics.record(measure());
+		return map;
+	}
+
+	template<std::floating_point Real>
+	void BasicSimulation<Real>::compute_forces(const std::vector<uint32_t>* active) {
+		const size_t count = active ? active->size() : bodies.size();
+		const bool potential = m_phi_due && !active;
+		stats.force_evaluations += count;
+		m_phi_ready = false;
+		if (gravity == solver::exact) {
+			stats.interactions += bodies.empty() ? 0 : count * ( bodies.size() - 1 );
+			if (active) direct_accelerations(bodies, *active, softening);
+			else {
+				if (potential) m_phi.resize(bodies.size());
+				direct_accelerations(bodies, softening, potential ? m_phi.data() : nullptr);
+				m_phi_ready = potential;
+			}
+			return;
+		}
+		if (gravity == solver::fmm) {
+			fmm.softening = softening;
+			fmm.potential = potential;
+			compute_single(fmm, active);
+			stats.interactions += fmm.interactions();
+			if (potential) m_phi.assign(fmm.potentials().begin(), fmm.potentials().end());
+			m_phi_ready = potential;
+			return;
+		}
+		if (gravity == solver::particle_mesh) {
+			mesh.box = border;
+			mesh.softening = softening;
+			mesh.potential = potential;
+			compute_single(mesh, active);
+			stats.interactions += mesh.interactions();
+			if (potential) m_phi.assign(mesh.potentials().begin(), mesh.potentials().end());
+			m_phi_ready = potential;
+			return;
+		}
+		//       ,          
+		update_tree();
+		if (tree.group_size > 0) {
+			stats.interactions += tree.accelerations(bodies.ax(), bodies.ay(), active);
+			return;
+		}
+		std::atomic<size_t> interactions = 0;
+		parallel_for(count, [this, active, &interactions](size_t i) {
+			size_t a = active ? ( *active )[i] : i, pulls = 0;
+			vector acc = tree.acceleration(bodies.position(a), int(a), &pulls, bodies.acceleration(a).length());
+			bodies.ax()[a] = acc.x;
+			bodies.ay()[a] = acc.y;
+			interactions.fetch_add(pulls, std::memory_order_relaxed);
+		});
+		stats.interactions += interactions;
+	}
+
+	template<std::floating_point Real>
+	void BasicSimulation<Real>::refresh_merged(const IndexMap& map) {
+		std::vector<uint32_t> merged;
+		for (size_t i = 0; i < map.old_size(); i++) if (!map.survives(int(i))) merged.push_back(uint32_t(map(int(i))));
+		std::sort(merged.begin(), merged.end());
+		merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+		if (merged.empty() || bodies.empty()) return;
+		if (integrator.method == scheme::hermite) {
+			hermite.refresh(bodies, softening, merged);
+			stats.force_evaluations += merged.size();
+			stats.interactions += merged.size() * ( bodies.size() - 1 );
+			return;
+		}
+		//            FMM  
+		if (gravity == solver::exact || merged.size() * 64 <= bodies.size()) {
+			direct_accelerations(bodies, merged, softening);
+			stats.force_evaluations += merged.size();
+			stats.interactions += merged.size() * ( bodies.size() - 1 );
+			return;
+		}
+		compute_forces(&merged);
+	}
+
+	template<std::floating_point Real>
+	void BasicSimulation<Real>::update_tree() {
+		tree.softening = softening;
+		if (tree.update(bodies)) stats.tree_builds++;
+		else stats.tree_refits++;
+		m_tree_ready = true;
+	}
+
+	template<std::floating_point Real>
+	void BasicSimulation<Real>::find_pairs() {
+		if (collisions == broadphase::sweep) m_sweep.find_pairs(bodies, m_pairs);
+		else m_collisions.find_pairs(bodies, m_pairs);
+	}
+
+	template<std::floating_point Real>
+	void BasicSimulation<Real>::find_impacts(Real h) {
+		if (collisions == broadphase::sweep) m_sweep.find_swept_pairs(bodies, h, m_pairs);
+		else m_collisions.find_swept_pairs(bodies, h, m_pairs);
+		m_impacts.resize(m_pairs.size());
+		for (size_t k = 0; k < m_pairs.size(); k++) m_impacts[k] = impact_time(bodies, m_pairs[k].first, m_pairs[k].second, h);
+	}
+
+	template<std::floating_point Real>
+	template<typename Solver>
+	void BasicSimulation<Real>::compute_single(Solver& s, const std::vector<uint32_t>* active) {
+		if constexpr (std::is_same_v<Real, float>) {
+			if (active) s.compute(bodies, *active);
+			else s.compute(bodies);
+		}
+		else {
+			m_single.assign(bodies);
+			if (active) s.compute(m_single, *active);
+			else s.compute(m_single);
+			const size_t count = active ? active->size() : bodies.size();
+			for (size_t k = 0; k < count; k++) {
+				size_t i = active ? ( *active )[k] : k;
+				bodies.ax()[i] = m_single.ax()[i];
+				bodies.ay()[i] = m_single.ay()[i];
+			}
+		}
+	}
+
+	template<std::floating_point Real>
+	void BasicSimulation<Real>::invalidate_forces() {
+		integrator.invalidate();
+		blocks.invalidate();
+		hermite.invalidate();
+		m_pairs_ready = false;
+		m_tree_ready = false;
+		m_phi_ready = false;
+	}
+
+	template<std::floating_point Real>
+	ConservedQuantities BasicSimulation<Real>::measure() {
+		ConservedQuantities q = motion(bodies);
+		auto sum = [this](const auto& phi) {
+			double e = 0.0;
+			for (size_t i = 0; i < bodies.size(); i++) e += 0.5 * double(bodies.mass()[i]) * double(phi[i]);
+			return e;
+		};
+		if (m_phi_ready) q.potential = sum(m_phi);
+		else if (gravity == solver::exact) q.potential = potential_energy(bodies, softening);
+		else if (gravity == solver::barnes_hut) {
+			//        ,        
+			tree.softening = softening;
+			if (!m_tree_ready) tree.update(bodies);
+			m_tree_ready = true;
+			q.potential = potential_energy(tree, bodies);
+		}
+		else {
+			//   ,     
+			m_single.assign(bodies);
+			if (gravity == solver::fmm) {
+				fmm.softening = softening;
+				fmm.potential = true;
+				fmm.compute(m_single);
+				fmm.potential = false;
+				q.potential = sum(fmm.potentials());
+			}
+			else {
+				mesh.box = border;
+				mesh.softening = softening;
+				mesh.potential = true;
+				mesh.compute(m_single);
+				mesh.potential = false;
+				q.potential = sum(mesh.potentials());
+			}
+		}
+		return q;
+	}
+
+	template<std::floating_point Real>
+	void BasicSimulation<Real>::spawn(vector position, Real mass) {
+		bodies.emplace_back(position, mass);
+		invalidate_forces();
+		diagnostics.reset();
+	}
+
+	template<std::floating_point Real>
+	void BasicSimulation<Real>::clear() {
+		bodies.clear();
+		bodies.shrink_to_fit();
+		m_sweep.reset();
+		tree.reset();
+		invalidate_forces();
+		diagnostics.reset();
+	}
+
+	template class BasicSimulation<float>;
+	template class BasicSimulation<double>;
+}
\ No newline at end of file
@@ -0,0 +1,201 @@
+#pragma once
+#include <concepts>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+#include "body_system.h"
+#include "barnes_hut.h"
+#include "fmm.h"
+#include "pm.h"
+#include "collision.h"
+#include "merge.h"
+#include "index_map.h"
+#include "integrator.h"
+#include "block_steps.h"
+#include "hermite.h"
+#include "morton.h"
+#include "softening.h"
+#include "diagnostics.h"
+
+namespace grav
+{
+	//   :   ,  -,   
+	//    
+	enum class solver { exact, barnes_hut, fmm, particle_mesh };
+
+	inline const char* solver_name(solver s) {
+		switch (s) {
+		case solver::exact: return "exact";
+		case solver::barnes_hut: return "tree";
+		case solver::fmm: return "fmm";
+		case solver::particle_mesh: return "pm";
+		}
+		return "?";
+	}
+
+	inline bool parse_solver(std::string_view name, solver& s) {
+		for (solver c : { solver::exact, solver::barnes_hut, solver::fmm, solver::particle_mesh })
+			if (name == solver_name(c)) {
+				s = c;
+				return true;
+			}
+		return false;
+	}
+
+	//  :   float; float      (  float);
+	//   double (BasicSimulation<double>)
+	enum class precision { single, mixed, double_ };
+
+	inline const char* precision_name(precision p) {
+		switch (p) {
+		case precision::single: return "single";
+		case precision::mixed: return "mixed";
+		case precision::double_: return "double";
+		}
+		return "?";
+	}
+
+	inline bool parse_precision(std::string_view name, precision& p) {
+		for (precision c : { precision::single, precision::mixed, precision::double_ })
+			if (name == precision_name(c)) {
+				p = c;
+				return true;
+			}
+		return false;
+	}
+
+	//  ,     (stats = {})
+	struct SimulationStats
+	{
+		size_t steps = 0;
+		size_t body_steps = 0;			//     
+		size_t force_evaluations = 0;	//      
+		size_t interactions = 0;		//   (  - -)
+		size_t merges = 0;				//  
+		size_t tree_builds = 0;			//   
+		size_t tree_refits = 0;			//    
+	};
+
+	//      : , ,   ;
+	// Real -     ,      (bodies.set_compensated)
+	template<std::floating_point Real>
+	class BasicSimulation {
+	public:
+		using vector = evo::Vector2<Real>;
+
+		BasicBodySystem<Real> bodies;
+		//     [-border, border]
+		float border = 100.0f;
+
+		solver gravity = solver::exact;
+		//    ,     FMM;    
+		Softening softening;
+		BasicQuadTree<Real> tree;
+		// FMM     float:       
+		FmmSolver fmm;
+		//    ,     border   
+		ParticleMesh mesh;
+
+		//   
+		broadphase collisions = broadphase::hash;
+		//  : ,    ,       
+		//     ;       
+		bool continuous = false;
+
+		BasicIntegrator<Real> integrator;
+		//     
+		bool block_steps = false;
+		BasicBlockTimesteps<Real> blocks;
+		// integrator.method == scheme::hermite:       ,  
+		//   ;  block_steps      h / 2^blocks.max_level
+		BasicHermite<Real> hermite;
+
+		//        Z- (0 - )
+		int reorder_interval = 16;
+
+		SimulationStats stats;
+		// , ,       diagnostics.interval 
+		ConservationMonitor diagnostics;
+
+		//     h;     
+		IndexMap step(Real h);
+
+		//   :     ,    active
+		void compute_forces(const std::vector<uint32_t>* active = nullptr);
+		//      (,    )
+		void invalidate_forces();
+
+		//     .        ,
+		//      :      , FMM       
+		// .    :  ,      FMM     ;
+		//    stats  
+		ConservedQuantities measure();
+
+		void spawn(vector position, Real mass);
+		void clear();
+
+		//   (  )  ,     
+		template<std::floating_point Other>
+		void copy_settings(const BasicSimulation<Other>& other) {
+			border = other.border;
+			gravity = other.gravity;
+			softening = other.softening;
+			tree.theta = other.tree.theta;
+			tree.criterion = other.tree.criterion;
+			tree.tolerance = other.tree.tolerance;
+			tree.refit = other.tree.refit;
+			tree.rebuild_fraction = other.tree.rebuild_fraction;
+			tree.group_size = other.tree.group_size;
+			fmm = other.fmm;
+			mesh = other.mesh;
+			integrator.method = other.integrator.method;
+			block_steps = other.block_steps;
+			blocks.max_level = other.blocks.max_level;
+			blocks.eta = other.blocks.eta;
+			hermite.eta = other.hermite.eta;
+			reorder_interval = other.reorder_interval;
+			collisions = other.collisions;
+			continuous = other.continuous;
+			diagnostics.interval = other.diagnostics.interval;
+			diagnostics.log = other.diagnostics.log;
+		}
+
+	private:
+		SpatialHash m_collisions;
+		SweepAndPrune m_sweep;
+		std::vector<CollisionPair> m_pairs;
+		std::vector<Real> m_impacts;	//       
+		// m_pairs    
+		bool m_pairs_ready = false;
+		BasicMergeResolver<Real> m_merges;
+		MortonSort m_morton;
+		int m_since_reorder = 0;
+		//    float  FMM  ,  Real -  float
+		BodySystem m_single;
+		// tree       
+		bool m_tree_ready = false;
+		//    :         m_phi
+		bool m_phi_due = false;
+		// m_phi    
+		bool m_phi_ready = false;
+		std::vector<Real> m_phi;
+
+		//  :    ,     - 
+		void refresh_merged(const IndexMap& map);
+		//    :    ,   tree.refit
+		void update_tree();
+
+		//     m_pairs  
+		void find_pairs();
+		// ,     h,     m_impacts
+		void find_impacts(Real h);
+		// FMM     ( m_single,     float)
+		template<typename Solver>
+		void compute_single(Solver& s, const std::vector<uint32_t>* active);
+	};
+
+	using Simulation = BasicSimulation<float>;
+
+	extern template class BasicSimulation<float>;
+	extern template class BasicSimulation<double>;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+#include <EvoNDZ/math/vector2.h>
+#include <vector>
+#include "body_system.h"
+
+namespace grav
+{
+	//  ,   ,      
+	struct BodySnapshot
+	{
+		std::vector<float> x, y, vx, vy, mass, r;
+
+		template<typename Real>
+		void take(const BasicBodySystem<Real>& bodies) {
+			const size_t n = bodies.size();
+			x.assign(bodies.x(), bodies.x() + n);
+			y.assign(bodies.y(), bodies.y() + n);
+			vx.assign(bodies.vx(), bodies.vx() + n);
+			vy.assign(bodies.vy(), bodies.vy() + n);
+			mass.assign(bodies.mass(), bodies.mass() + n);
+			r.assign(bodies.r(), bodies.r() + n);
+		}
+
+		size_t size() const noexcept { return x.size(); }
+		evo::Vector2f position(size_t i) const noexcept { return evo::Vector2f(x[i], y[i]); }
+		evo::Vector2f velocity(size_t i) const noexcept { return evo::Vector2f(vx[i], vy[i]); }
+	};
+
+	//  :    ,   ;
+	// publish     ,    
+	class SnapshotBuffer {
+	public:
+		const BodySnapshot& front() const noexcept { return m_buffers[m_front]; }
+		BodySnapshot& back() noexcept { return m_buffers[1 - m_front]; }
+		void publish() noexcept { m_front = 1 - m_front; }
+
+	private:
+		BodySnapshot m_buffers[2];
+		int m_front = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <string_view>
+
+namespace grav
+{
+	//      length:    ,
+	//        
+	enum class softening_model { none, plummer, spline, truncated };
+
+	inline const char* softening_name(softening_model s) {
+		switch (s) {
+		case softening_model::none: return "none";
+		case softening_model::plummer: return "plummer";
+		case softening_model::spline: return "spline";
+		case softening_model::truncated: return "truncated";
+		}
+		return "?";
+	}
+
+	inline bool parse_softening(std::string_view name, softening_model& s) {
+		for (softening_model c : { softening_model::none, softening_model::plummer, softening_model::spline, softening_model::truncated })
+			if (name == softening_name(c)) {
+				s = c;
+				return true;
+			}
+		return false;
+	}
+
+	struct Softening
+	{
+		softening_model model = softening_model::plummer;
+		//   - eps,   - ,     ,
+		//   - ,       
+		float length = 0.02f;
+	};
+
+	//  : a = G m d * inv_cube(r^2, length),    inv_cube = 1 / r^3;
+	// potential(r^2, length) -    G m,   ;
+	// slope(r^2, length) = 2 d inv_cube / d r^2  : da/dt = G m (dv * inv_cube + d (d . dv) * slope).
+	//   (r^2 = 0,     )  0;    ,  
+	namespace soften
+	{
+		struct none
+		{
+			template<typename Real>
+			static Real inv_cube(Real r2, Real) {
+				Real inv = 1 / std::sqrt(r2);
+				return r2 > 0 ? inv * inv * inv : Real(0);
+			}
+
+			template<typename Real>
+			static Real potential(Real r2, Real) {
+				return r2 > 0 ? -1 / std::sqrt(r2) : Real(0);
+			}
+
+			template<typename Real>
+			static Real slope(Real r2, Real) {
+				Real inv = 1 / std::sqrt(r2);
+				return r2 > 0 ? -3 * inv * inv * inv * inv * inv : Real(0);
+			}
+		};
+
+		// 1 / (r^2 + eps^2)^(3/2)
+		struct plummer
+		{
+			template<typename Real>
+			static Real inv_cube(Real r2, Real length) {
+				Real inv = 1 / std::sqrt(r2 + length * length);
+				return r2 > 0 ? inv * inv * inv : Real(0);
+			}
+
+			template<typename Real>
+			static Real potential(Real r2, Real length) {
+				return -1 / std::sqrt(r2 + length * length);
+			}
+
+			template<typename Real>
+			static Real slope(Real r2, Real length) {
+				Real inv = 1 / std::sqrt(r2 + length * length);
+				return r2 > 0 ? -3 * inv * inv * inv * inv * inv : Real(0);
+			}
+		};
+
+		//    (  Gadget):      length
+		struct spline
+		{
+			template<typename Real>
+			static Real inv_cube(Real r2, Real length) {
+				const Real inv_h = 1 / length, inv_h3 = inv_h * inv_h * inv_h;
+				Real inv = 1 / std::sqrt(r2);
+				Real u = r2 * inv * inv_h, u2 = u * u;
+				Real far = inv * inv * inv;
+				Real near = inv_h3 * ( Real(32) / 3 + u2 * ( 32 * u - Real(38.4) ) );
+				Real mid = inv_h3 * ( Real(64) / 3 + u * ( -48 + u * ( Real(38.4) - Real(32) / 3 * u ) ) ) - far / 15;
+				Real f = u < Real(0.5) ? near : u < 1 ? mid : far;
+				return r2 > 0 ? f : Real(0);
+			}
+
+			template<typename Real>
+			static Real potential(Real r2, Real length) {
+				const Real inv_h = 1 / length;
+				Real r = std::sqrt(r2), u = r * inv_h, u2 = u * u;
+				Real near = inv_h * ( Real(-2.8) + u2 * ( Real(16) / 3 + u2 * ( Real(6.4) * u - Real(9.6) ) ) );
+				Real mid = inv_h * ( Real(-3.2) + u2 * ( Real(32) / 3 + u * ( -16 + u * ( Real(9.6) - Real(32) / 15 * u ) ) ) )
+					+ 1 / ( 15 * r );
+				return u < Real(0.5) ? near : u < 1 ? mid : -1 / r;
+			}
+
+			template<typename Real>
+			static Real slope(Real r2, Real length) {
+				const Real inv_h = 1 / length, inv_h2 = inv_h * inv_h, inv_h5 = inv_h2 * inv_h2 * inv_h;
+				Real inv = 1 / std::sqrt(r2);
+				Real u = r2 * inv * inv_h, iu = 1 / u, iu2 = iu * iu;
+				Real far = -3 * inv * inv * inv * inv * inv;
+				Real near = inv_h5 * ( 96 * u - Real(76.8) );
+				Real mid = inv_h5 * ( Real(76.8) - 48 * iu - 32 * u + Real(0.2) * iu2 * iu2 * iu );
+				Real f = u < Real(0.5) ? near : u < 1 ? mid : far;
+				return r2 > 0 ? f : Real(0);
+			}
+		};
+
+		//  length   ,    : 1 / max(r, length)^3
+		struct truncated
+		{
+			template<typename Real>
+			static Real inv_cube(Real r2, Real length) {
+				Real inv = 1 / std::sqrt(std::max(r2, length * length));
+				return r2 > 0 ? inv * inv * inv : Real(0);
+			}
+
+			template<typename Real>
+			static Real potential(Real r2, Real length) {
+				const Real inv_h = 1 / length;
+				return r2 < length * length ? inv_h * ( r2 * inv_h * inv_h - 3 ) / 2 : -1 / std::sqrt(r2);
+			}
+
+			//  length    d, inv_cube 
+			template<typename Real>
+			static Real slope(Real r2, Real length) {
+				Real inv = 1 / std::sqrt(r2);
+				return r2 > length * length ? -3 * inv * inv * inv * inv * inv : Real(0);
+			}
+		};
+	}
+
+	//  f    ;    ,     
+	template<typename F>
+	decltype(auto) with_softening(softening_model model, F&& f) {
+		switch (model) {
+		case softening_model::plummer: return f(soften::plummer{});
+		case softening_model::spline: return f(soften::spline{});
+		case softening_model::truncated: return f(soften::truncated{});
+		default: return f(soften::none{});
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,286 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+#if defined(_WIN32)
+extern "C" __declspec(dllimport) void* __stdcall GetCurrentThread();
+extern "C" __declspec(dllimport) unsigned long long __stdcall SetThreadAffinityMask(void* thread, unsigned long long mask);
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace evo
+{
+	// Counts the tasks submitted under it that have not finished yet and keeps the first exception they threw.
+	class TaskGroup {
+	public:
+		TaskGroup() = default;
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+
+		bool done() const noexcept {
+			return m_pending.load(std::memory_order_acquire) == 0;
+		}
+
+		friend class ThreadPool;
+
+	private:
+		std::atomic<size_t> m_pending = 0;
+		std::mutex m_errorMutex;
+		std::exception_ptr m_error;
+
+		void fail(std::exception_ptr error) {
+			std::lock_guard lock(m_errorMutex);
+			if (!m_error) m_error = error;
+		}
+	};
+
+	// Persistent work-stealing pool. Every thread owns a deque: it pushes and pops its own tasks at the back
+	// and steals from the front of the other deques when its own is empty, so the largest pieces of a split
+	// range are the ones that migrate. A thread waiting for a group runs pending tasks instead of blocking,
+	// therefore nested parallel_for calls and task graphs neither deadlock nor oversubscribe the cores.
+	class ThreadPool {
+	public:
+		using Task = std::function<void()>;
+
+		// workers - background threads; the thread that calls wait() works as one more.
+		// With pin set worker i is bound to logical core i + 1, core 0 is left for the calling thread.
+		explicit ThreadPool(size_t workers = std::max(1u, std::thread::hardware_concurrency()) - 1, bool pin = false)
+			: m_queues(workers + 1), m_pinned(pin)
+		{
+			for (auto& q : m_queues) q = std::make_unique<Queue>();
+			m_workers.reserve(workers);
+			for (size_t w = 0; w < workers; w++) m_workers.emplace_back([this, w]() { work(w + 1); });
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		~ThreadPool() {
+			{
+				std::lock_guard lock(m_sleepMutex);
+				m_stop = true;
+			}
+			m_wake.notify_all();
+			for (auto& t : m_workers) t.join();
+		}
+
+		size_t workers() const noexcept { return m_workers.size(); }
+		// threads that execute tasks while someone waits: the workers plus the waiting thread
+		size_t concurrency() const noexcept { return m_workers.size() + 1; }
+		bool pinned() const noexcept { return m_pinned; }
+
+		void submit(TaskGroup& group, Task task) {
+			group.m_pending.fetch_add(1, std::memory_order_relaxed);
+			Local& local = current();
+			Queue& q = *m_queues[local.pool == this ? local.index : 0];
+			{
+				std::lock_guard lock(q.mutex);
+				q.tasks.emplace_back([&group, task = std::move(task)]() {
+					try {
+						task();
+					}
+					catch (...) {
+						group.fail(std::current_exception());
+					}
+					group.m_pending.fetch_sub(1, std::memory_order_release);
+				});
+			}
+			m_queued.fetch_add(1);
+			if (m_sleeping.load() > 0) {
+				std::lock_guard lock(m_sleepMutex);
+				m_wake.notify_one();
+			}
+		}
+
+		// Runs pending tasks until every task of the group has finished, then rethrows the first exception.
+		void wait(TaskGroup& group) {
+			while (!group.done()) {
+				if (!run_one()) std::this_thread::yield();
+			}
+			if (group.m_error) {
+				std::exception_ptr error = group.m_error;
+				group.m_error = nullptr;
+				std::rethrow_exception(error);
+			}
+		}
+
+		// Calls f(i) for every i in [begin, end) exactly once. The range is split in halves down to grain
+		// indices; the calling thread keeps the leftmost piece and idle threads steal the rest.
+		template<typename F>
+		void parallel_for(size_t begin, size_t end, size_t grain, F&& f) {
+			if (end <= begin) return;
+			grain = std::max<size_t>(grain, 1);
+			if (end - begin <= grain || m_workers.empty()) {
+				for (size_t i = begin; i < end; i++) f(i);
+				return;
+			}
+			TaskGroup group;
+			try {
+				split(group, begin, end, grain, f);
+			}
+			catch (...) {
+				group.fail(std::current_exception());
+			}
+			wait(group);
+		}
+
+		// Binds the calling thread to one logical core; returns false where affinity is unsupported.
+		static bool pin_current_thread(size_t core) {
+			const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+			core %= cores;
+#if defined(_WIN32)
+			return core < 64 && SetThreadAffinityMask(GetCurrentThread(), 1ull << core) != 0;
+#elif defined(__linux__)
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(core, &set);
+			return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+			return false;
+#endif
+		}
+
+	private:
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		// which pool and deque the current thread works for
+		struct Local
+		{
+			ThreadPool* pool = nullptr;
+			size_t index = 0;
+		};
+
+		std::vector<std::unique_ptr<Queue>> m_queues;
+		std::vector<std::thread> m_workers;
+		bool m_pinned;
+		std::atomic<size_t> m_queued = 0;
+		std::atomic<size_t> m_sleeping = 0;
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wake;
+		bool m_stop = false;
+
+		static Local& current() noexcept {
+			static thread_local Local local;
+			return local;
+		}
+
+		template<typename F>
+		void split(TaskGroup& group, size_t begin, size_t end, size_t grain, F& f) {
+			while (end - begin > grain) {
+				size_t middle = begin + ( end - begin ) / 2;
+				submit(group, [this, &group, &f, middle, end, grain]() { split(group, middle, end, grain, f); });
+				end = middle;
+			}
+			for (size_t i = begin; i < end; i++) f(i);
+		}
+
+		// own deque from the back, then the others from the front
+		bool run_one() {
+			if (m_queued.load() == 0) return false;
+			Local& local = current();
+			const size_t self = local.pool == this ? local.index : 0;
+			Task task;
+			for (size_t k = 0; k < m_queues.size() && !task; k++) {
+				Queue& q = *m_queues[( self + k ) % m_queues.size()];
+				std::lock_guard lock(q.mutex);
+				if (q.tasks.empty()) continue;
+				if (k == 0) {
+					task = std::move(q.tasks.back());
+					q.tasks.pop_back();
+				}
+				else {
+					task = std::move(q.tasks.front());
+					q.tasks.pop_front();
+				}
+			}
+			if (!task) return false;
+			m_queued.fetch_sub(1);
+			task();
+			return true;
+		}
+
+		void work(size_t index) {
+			current() = Local { this, index };
+			if (m_pinned) pin_current_thread(index);
+			while (true) {
+				if (run_one()) continue;
+				std::unique_lock lock(m_sleepMutex);
+				m_sleeping.fetch_add(1);
+				m_wake.wait(lock, [this]() { return m_stop || m_queued.load() > 0; });
+				m_sleeping.fetch_sub(1);
+				if (m_stop) return;
+			}
+		}
+	};
+
+	// Tasks with dependencies: a node starts once every node that precedes it has finished.
+	// The graph is kept between runs, so a frame can describe its work once and run it every frame.
+	class TaskGraph {
+	public:
+		using Node = size_t;
+
+		Node add(std::function<void()> work) {
+			m_nodes.emplace_back();
+			m_nodes.back().work = std::move(work);
+			return m_nodes.size() - 1;
+		}
+
+		// after starts only when before has finished
+		void precede(Node before, Node after) {
+			m_nodes[before].successors.push_back(after);
+			m_nodes[after].dependencies++;
+		}
+
+		size_t size() const noexcept { return m_nodes.size(); }
+		void clear() { m_nodes.clear(); }
+
+		// Runs the graph on the pool and returns when every node has finished. If a node throws, its successors
+		// are skipped and the first exception is rethrown; a dependency cycle throws std::logic_error.
+		void run(ThreadPool& pool) {
+			TaskGroup group;
+			std::atomic<size_t> finished = 0;
+			for (Entry& n : m_nodes) n.remaining.store(n.dependencies, std::memory_order_relaxed);
+			for (Node i = 0; i < m_nodes.size(); i++)
+				if (m_nodes[i].dependencies == 0) launch(pool, group, i, finished);
+			pool.wait(group);
+			if (finished.load() != m_nodes.size()) throw std::logic_error("TaskGraph: dependency cycle");
+		}
+
+	private:
+		struct Entry
+		{
+			std::function<void()> work;
+			std::vector<size_t> successors;
+			size_t dependencies = 0;
+			std::atomic<size_t> remaining = 0;
+		};
+
+		std::deque<Entry> m_nodes;
+
+		void launch(ThreadPool& pool, TaskGroup& group, size_t i, std::atomic<size_t>& finished) {
+			pool.submit(group, [this, &pool, &group, i, &finished]() {
+				Entry& n = m_nodes[i];
+				if (n.work) n.work();
+				finished.fetch_add(1);
+				for (size_t s : n.successors)
+					if (m_nodes[s].remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) launch(pool, group, s, finished);
+			});
+		}
+	};
+}
\ No newline at end of file